@@ -3,6 +3,7 @@
 #include "common.hpp"
 #include "minimizer_base.hpp"
 #include <eigen3/Eigen/Eigen>
+#include <vector>
 
 template <typename M>
 constexpr bool isSparse = std::is_base_of_v<Eigen::SparseMatrixBase<M>, M>;
@@ -13,6 +14,9 @@ using DefaultSolverT = typename std::conditional<
     Eigen::ConjugateGradient<M>,
     Eigen::LDLT<M>>::type;
 
+template <typename S>
+constexpr bool isIterativeSolver = std::is_base_of_v<Eigen::IterativeSolverBase<S>, S>;
+
 /**
  * @brief BFGS (Broyden–Fletcher–Goldfarb–Shanno) minimizer.
  *
@@ -24,6 +28,19 @@ using DefaultSolverT = typename std::conditional<
  * @tparam V Vector type (e.g. Eigen::VectorXd).
  * @tparam M Matrix type (e.g. Eigen::MatrixXd).
  * @tparam Solver if specified can be used to specify solver type  (e.g. Eigen::ConjugateGradient) and must must be passed to the constructor
+ *
+ * When @p Solver is an Eigen iterative solver (ConjugateGradient, GMRES, ...)
+ * the linear systems are solved inexactly: each solve is warm-started from
+ * the previous direction, and its relative tolerance follows the forcing
+ * sequence η_k = min(η_max, sqrt(||∇f(x_k)||)), never tighter than the
+ * tolerance configured on the solver when solve() is called. Since consecutive directions are
+ * strongly correlated this cuts most of the inner iterations while keeping
+ * superlinear convergence.
+ *
+ * The BFGS updates fill B in, so a sparse @p M (e.g. Eigen::SparseMatrix)
+ * only stores B_0 sparsely: after the first update B is dense in sparse
+ * storage, with n² entries, and every iteration costs O(n²) like the dense
+ * version. Sparse M is meant for a sparse B_0 and solver, not for large n.
  */
 template <typename V, typename M, typename Solver = DefaultSolverT<M>>
 class BFGS : public MinimizerBase<V, M> {
@@ -57,15 +74,52 @@ protected:
 private:
   SolverT _solver;
 
+  /// Tolerance configured on the iterative solver when solve() starts,
+  /// lower bound for η_k; restored after every inexact solve.
+  double _base_tol = 0.0;
+
+  /// Upper bound η_max of the forcing sequence.
+  double _eta_max = 0.1;
+
+  /// Rebuild the preconditioner every this many iterations.
+  unsigned int _refresh = 1;
+
+  /// Inner iterations of the iterative solver in the last solve().
+  long _inner_iters = 0;
+
+  /// B was reallocated since the solver last saw it (sparse fill-in).
+  bool _storage_changed = false;
+
 public:
   BFGS()
-  requires(UseDefaultSolver) {
-    _solver = DefaultSolverT<M>();
-  }
+  requires(UseDefaultSolver) {}
 
   BFGS(Solver &solver)
-  requires(!UseDefaultSolver) : _solver(solver) {
-  }
+  requires(!UseDefaultSolver) : _solver(solver) {}
+
+  /**
+   * @brief Set the upper bound η_max of the forcing sequence.
+   *
+   * Only used with iterative solvers; 0 solves every system to the
+   * solver's own tolerance.
+   */
+  void setForcingTerm(double eta_max) noexcept { _eta_max = eta_max; }
+
+  /**
+   * @brief Rebuild the preconditioner only every @p k iterations.
+   *
+   * Only used with iterative solvers. In between, the solver keeps working
+   * on the up-to-date matrix (it references B, which is updated in place;
+   * a sparse B is refactored once more when the first update fills it in)
+   * with the previous preconditioner.
+   */
+  void setPreconditionerRefresh(unsigned int k) noexcept { _refresh = std::max(1u, k); }
+
+  /**
+   * @brief Get the total number of inner iterations of the iterative solver
+   * in the last solve() (0 for direct solvers).
+   */
+  long innerIterations() const noexcept { return _inner_iters; }
 
   /**
    * @brief Run the BFGS optimization method.
@@ -78,7 +132,8 @@ public:
    *
    * The loop stops when either:
    *  - the gradient norm falls below the tolerance, or
-   *  - the maximum number of iterations is reached.
+   *  - the maximum number of iterations is reached, or
+   *  - one of the tests set with setTermination() triggers (see status()).
    *
    * @param x Initial guess for the minimizer (passed by value).
    * @param f Objective function to minimize, mapping V → double.
@@ -88,36 +143,116 @@ public:
    */
   V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
 
-    for (_iters = 0; _iters < _max_iters && Gradient(x).norm() > _tol;
-         ++_iters) {
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
 
-      // Factorize B and check success
-      _solver.compute(_B);
-      check(_solver.info() == Eigen::Success, "conjugate gradient solver error");
+    V g(x.size()), x_next(x.size()), g_next(x.size());
+    V p = V::Zero(x.size());
+    double fx = f_counted(x);
+    grad_counted(x, g);
+    _inner_iters = 0;
+    if constexpr (isIterativeSolver<Solver>)
+      _base_tol = _solver.tolerance();
+
+    for (_iters = 0; this->keep_going(g.norm()); ++_iters) {
 
       // Search direction: p = -B^{-1} ∇f(x)
-      V p = _solver.solve(-Gradient(x));
+      if constexpr (isIterativeSolver<Solver>) {
+        solve_inexact(g, p);
+      } else {
+        // Factorize B and check success
+        _solver.compute(_B);
+        check(_solver.info() == Eigen::Success, "conjugate gradient solver error");
+        p = _solver.solve(-g);
+      }
 
-      // Line search to determine step length alpha
-      double alpha = 1.0;
-      alpha = this->line_search(x, p, f, Gradient);
+      // Line search to determine step length alpha; also evaluates f and
+      // ∇f at the new iterate
+      double f_next;
+      double alpha = this->line_search(x, p, fx, g.dot(p), f_counted, grad_counted,
+                                       x_next, f_next, g_next);
 
       // Step and new iterate
       V s = alpha * p; ///< s_k = x_{k+1} − x_k.
-      V x_next = x + s;
 
       // Gradient difference
-      V y = Gradient(x_next) - Gradient(x); ///< y_k = ∇f_{k+1} − ∇f_k.
+      V y = g_next - g; ///< y_k = ∇f_{k+1} − ∇f_k.
 
       // BFGS update: B_{k+1} = B_k + (y yᵀ)/(yᵀ s) − (B s sᵀ B)/(sᵀ B s)
-      M b_prod = _B * s;
-      _B = _B + (y * y.transpose()) / (y.transpose() * s) -
-           (b_prod * b_prod.transpose()) / (s.transpose() * _B * s);
+      V b_prod = _B * s;
+      double ys = y.dot(s);
+      double sbs = s.dot(b_prod);
+      if constexpr (isSparse<M>) {
+        update_sparse(y, b_prod, ys, sbs);
+      } else {
+        _B.noalias() += y * y.transpose() / ys;
+        _B.noalias() -= b_prod * b_prod.transpose() / sbs;
+      }
+
+      this->check_step(fx, f_next, s.norm(), x.norm());
 
       // Move to the next iterate
-      x = x_next;
+      x.swap(x_next);
+      g.swap(g_next);
+      fx = f_next;
     }
 
     return x;
   }
+
+private:
+  /**
+   * @brief BFGS update of a sparse B, with the values of the dense update.
+   *
+   * The first update gives B the full n × n pattern, explicit zeros
+   * included; later updates write its value array in place, so the storage
+   * referenced by the solver between preconditioner refreshes stays valid.
+   */
+  void update_sparse(const V &y, const V &b_prod, double ys, double sbs) {
+    const Eigen::Index n = _B.rows();
+    if (_B.nonZeros() != n * n || !_B.isCompressed()) {
+      Eigen::MatrixXd dense(_B);
+      std::vector<Eigen::Triplet<double>> entries;
+      entries.reserve(n * n);
+      for (Eigen::Index j = 0; j < n; ++j)
+        for (Eigen::Index i = 0; i < n; ++i)
+          entries.emplace_back(i, j, dense(i, j));
+      _B.setFromTriplets(entries.begin(), entries.end());
+      _B.makeCompressed();
+      _storage_changed = true;
+    }
+    check((_B.isCompressed() && _B.nonZeros() == n * n), "sparse BFGS matrix must be dense in sparse storage");
+
+    // B is symmetric, so its value array is the dense matrix in either storage order
+    Eigen::Map<Eigen::MatrixXd> values(_B.valuePtr(), n, n);
+    values.noalias() += y * y.transpose() / ys;
+    values.noalias() -= b_prod * b_prod.transpose() / sbs;
+  }
+
+  /**
+   * @brief Inexact solve of B p = -g with an iterative solver.
+   *
+   * Warm-starts from the previous direction stored in @p p and uses the
+   * forcing-sequence tolerance. Falls back to a cold solve at the base
+   * tolerance if the inexact direction is not a descent direction.
+   */
+  void solve_inexact(const V &g, V &p) {
+    if (_iters % _refresh == 0 || _storage_changed)
+      _solver.compute(_B);
+    _storage_changed = false;
+    check(_solver.info() == Eigen::Success, "iterative solver setup error");
+
+    double eta = std::min(_eta_max, std::sqrt(g.norm()));
+    _solver.setTolerance(std::max(_base_tol, eta));
+    p = _iters == 0 ? V(_solver.solve(-g)) : V(_solver.solveWithGuess(-g, p));
+    _inner_iters += _solver.iterations();
+
+    if (p.dot(g) >= 0.0) {
+      _solver.setTolerance(_base_tol);
+      p = _solver.solve(-g);
+      _inner_iters += _solver.iterations();
+    }
+    _solver.setTolerance(_base_tol);
+  }
 };
@@ -27,4 +27,20 @@ template <typename T, typename W>
 using VecFun = std::function<W(T)>;
 
 template <typename V, typename M>
-using HessFun = std::function<M(V)>;
\ No newline at end of file
+using HessFun = std::function<M(V)>;
+
+/// Objective on a borrowed vector, used by the zero-copy solver entry points.
+template <typename V>
+using RefVecFun = std::function<double(const Eigen::Ref<const V> &)>;
+
+/// Gradient written in place into a borrowed vector (x, out).
+template <typename V>
+using RefGradFun = std::function<void(const Eigen::Ref<const V> &, Eigen::Ref<V>)>;
+
+/// Jacobian of a vector function, as a dense or sparse matrix J.
+template <typename V, typename J>
+using JacobianFun = std::function<J(V)>;
+
+/// Matrix-free Jacobian product (x, v) -> J(x) v or J(x)ᵀ v.
+template <typename V>
+using JacobianProductFun = std::function<V(const V &, const V &)>;
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "common.hpp"
+#include "lbfgs.hpp"
+#include "minimizer_base.hpp"
+#include <chrono>
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+#include <limits>
+#include <mpi.h>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief How the problem is spread over the ranks of a DistributedLBFGS.
+ */
+enum class DistributedLayout {
+  /// Each rank owns a contiguous slice of x; f is the sum of per-rank
+  /// contributions (which may exchange halo values internally) and the
+  /// gradient callable returns the local slice of ∇f.
+  PartitionedParameters,
+  /// Every rank holds the whole x and a shard of a finite-sum objective;
+  /// values and gradients are summed over the ranks.
+  ShardedData
+};
+
+/**
+ * @brief Contiguous block [begin, end) of @p n items owned by this rank.
+ *
+ * Splits the items as evenly as possible, lower ranks first. Useful both to
+ * partition parameters and to shard the terms of a finite sum.
+ */
+inline std::pair<Eigen::Index, Eigen::Index> localRange(Eigen::Index n, MPI_Comm comm = MPI_COMM_WORLD) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  return {n * rank / size, n * (rank + 1) / size};
+}
+
+/**
+ * @brief Distributed-memory L-BFGS over the ranks of an MPI communicator.
+ *
+ * Runs the L-BFGS iteration with the two-loop recursion carried out on the
+ * Gram matrix of the basis {s_i, y_i, ∇f} instead of on the vectors
+ * themselves (vector-free L-BFGS). Only the dot products of the three new
+ * basis vectors need a global reduction, so every stage of an iteration
+ * costs a single batched MPI_Allreduce:
+ *  - direction: none (the recursion runs on the replicated Gram matrix);
+ *  - line search: one scalar for f and one for ∇fᵀp per trial step;
+ *  - update: one batch with the new rows of the Gram matrix.
+ *
+ * With DistributedLayout::ShardedData the vectors are replicated, the Gram
+ * matrix is computed locally and the reductions move to f and ∇f instead.
+ *
+ * f and Gradient are collective: every rank of the communicator must call
+ * solve() with the same settings. Termination tests that depend on the
+ * clock or on the cancellation token are agreed upon across ranks. The
+ * speculative line search is not supported and setSpeculativeTrials() has
+ * no effect.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd); only used for the base class.
+ */
+template <typename V, typename M>
+class DistributedLBFGS : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_iters;
+  using Base::_status;
+  using Base::_termination;
+  using Base::alpha_wolfe;
+  using Base::c1;
+  using Base::c2;
+  using Base::m;
+  using Base::max_line_iters;
+  using Base::rho;
+
+public:
+  /**
+   * @param comm Communicator spanning the ranks that share the problem.
+   * @param layout Distribution of parameters and data over the ranks.
+   */
+  explicit DistributedLBFGS(MPI_Comm comm = MPI_COMM_WORLD,
+                            DistributedLayout layout = DistributedLayout::PartitionedParameters)
+      : _comm(comm), _layout(layout) {}
+
+  /// Number of MPI_Allreduce calls issued by the last solve().
+  unsigned long allreduceCount() const noexcept { return _allreduces; }
+
+  /// Wall-clock time spent inside MPI_Allreduce by the last solve(), in seconds.
+  double communicationSeconds() const noexcept { return _comm_seconds; }
+
+  /**
+   * @brief Run distributed L-BFGS.
+   *
+   * @param x Initial guess: the local slice with PartitionedParameters, the
+   *        full vector (identical on every rank) with ShardedData.
+   * @param f Local contribution to the objective.
+   * @param Gradient Local slice of ∇f (PartitionedParameters) or gradient
+   *        of the local shard (ShardedData).
+   * @return Approximate minimizer, in the same layout as @p x.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    this->start_solve();
+    _allreduces = 0;
+    _comm_seconds = 0.0;
+
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
+    RefVecFun<V> f_global = [&](const Eigen::Ref<const V> &v) {
+      double val = f_counted(v);
+      allreduce(&val, 1);
+      return val;
+    };
+    RefGradFun<V> grad_global = [&](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) {
+      grad_counted(v, g);
+      if (_layout == DistributedLayout::ShardedData)
+        allreduce(g.data(), static_cast<int>(g.size()));
+    };
+
+    const Eigen::Index n = x.size();
+    if (_ws.size() != n || _ws.capacity() != m)
+      _ws = LBFGSWorkspace<V>(n, m);
+    _ws.clear();
+    _G.setZero(2 * m + 1, 2 * m + 1);
+    _delta.resize(2 * m + 1);
+    _dots.resize(3 * (2 * m + 1) + 1);
+
+    double fx = f_global(x);
+    grad_global(x, _ws.grad);
+
+    // ‖∇f‖² and ‖x‖² in one reduction
+    _dots(0) = _ws.grad.dot(_ws.grad);
+    _dots(1) = x.dot(x);
+    reduce_dots(2);
+    _G(grad_index(), grad_index()) = _dots(0);
+    double x_norm = std::sqrt(_dots(1));
+
+    for (_iters = 0; keep_going_collective(std::sqrt(_G(grad_index(), grad_index()))); ++_iters) {
+
+      // Search direction and ∇fᵀp from the Gram matrix, without communication
+      double grad_dot_p = compute_direction();
+
+      double f_new;
+      alpha_wolfe = line_search(x, fx, grad_dot_p, f_global, grad_global, f_new);
+
+      // Store the new pair, overwriting the oldest if full
+      size_t k = _ws.count < _ws.capacity() ? _ws.slot(_ws.count) : _ws.head;
+      _ws.s[k].noalias() = _ws.x_new - x;
+      _ws.y[k].noalias() = _ws.grad_new - _ws.grad;
+      if (_ws.count < _ws.capacity())
+        ++_ws.count;
+      else
+        _ws.head = (_ws.head + 1) % _ws.capacity();
+      _ws.grad.swap(_ws.grad_new);
+
+      double new_x_norm = update_gram(k);
+      _ws.rho[k] = 1.0 / _G(m + k, k);
+
+      this->check_step(fx, f_new, std::sqrt(_G(k, k)), x_norm);
+
+      x = _ws.x_new;
+      x_norm = new_x_norm;
+      fx = f_new;
+    }
+
+    return x;
+  }
+
+private:
+  /// Row of ∇f in the Gram matrix; s_k and y_k use rows k and m + k.
+  Eigen::Index grad_index() const noexcept { return static_cast<Eigen::Index>(2 * m); }
+
+  /// Sum @p count doubles over the ranks, in place.
+  void allreduce(double *data, int count) {
+    auto start = std::chrono::steady_clock::now();
+    MPI_Allreduce(MPI_IN_PLACE, data, count, MPI_DOUBLE, MPI_SUM, _comm);
+    _comm_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++_allreduces;
+  }
+
+  /// Reduce the first @p count local dot products, if the vectors are partitioned.
+  void reduce_dots(int count) {
+    if (_layout == DistributedLayout::PartitionedParameters)
+      allreduce(_dots.data(), count);
+  }
+
+  /**
+   * @brief Refresh the Gram matrix after storing the pair in slot @p k.
+   *
+   * Computes the local products of s_k, y_k and the new gradient with every
+   * stored basis vector, together with ‖x_new‖², and reduces them in a
+   * single batch.
+   *
+   * @return ‖x_new‖.
+   */
+  double update_gram(size_t k) {
+    const V *fresh[3] = {&_ws.s[k], &_ws.y[k], &_ws.grad};
+    const Eigen::Index fresh_rows[3] = {static_cast<Eigen::Index>(k),
+                                        static_cast<Eigen::Index>(m + k), grad_index()};
+
+    int count = 0;
+    for (const V *u : fresh) {
+      for (size_t i = 0; i < _ws.count; ++i) {
+        size_t j = _ws.slot(i);
+        _dots(count++) = u->dot(_ws.s[j]);
+        _dots(count++) = u->dot(_ws.y[j]);
+      }
+      _dots(count++) = u->dot(_ws.grad);
+    }
+    _dots(count++) = _ws.x_new.dot(_ws.x_new);
+    reduce_dots(count);
+
+    count = 0;
+    for (Eigen::Index r : fresh_rows) {
+      for (size_t i = 0; i < _ws.count; ++i) {
+        Eigen::Index j = static_cast<Eigen::Index>(_ws.slot(i));
+        _G(r, j) = _G(j, r) = _dots(count++);
+        _G(r, m + j) = _G(m + j, r) = _dots(count++);
+      }
+      _G(r, grad_index()) = _G(grad_index(), r) = _dots(count++);
+    }
+    return std::sqrt(_dots(count));
+  }
+
+  /**
+   * @brief Two-loop recursion in the coordinates of the basis {s, y, ∇f}.
+   *
+   * The coefficients δ of q = Σ δ_j b_j are updated with inner products
+   * read from the Gram matrix; p = −q is then formed locally.
+   *
+   * @return ∇fᵀp.
+   */
+  double compute_direction() {
+    _delta.setZero();
+    _delta(grad_index()) = 1.0;
+
+    if (_ws.count > 0) {
+      // First loop: backward pass
+      for (size_t i = _ws.count; i-- > 0;) {
+        size_t k = _ws.slot(i);
+        _ws.alpha[k] = _ws.rho[k] * _G.row(k).dot(_delta);
+        _delta(m + k) -= _ws.alpha[k];
+      }
+
+      // Scaling of the initial Hessian approximation H0 = γ I
+      size_t last = _ws.slot(_ws.count - 1);
+      _delta *= _G(last, m + last) / _G(m + last, m + last);
+
+      // Second loop: forward pass
+      for (size_t i = 0; i < _ws.count; ++i) {
+        size_t k = _ws.slot(i);
+        double beta = _ws.rho[k] * _G.row(m + k).dot(_delta);
+        _delta(k) += _ws.alpha[k] - beta;
+      }
+    }
+
+    _ws.p.noalias() = -_delta(grad_index()) * _ws.grad;
+    for (size_t i = 0; i < _ws.count; ++i) {
+      size_t k = _ws.slot(i);
+      _ws.p.noalias() -= _delta(k) * _ws.s[k] + _delta(m + k) * _ws.y[k];
+    }
+    return -_G.row(grad_index()).dot(_delta);
+  }
+
+  /**
+   * @brief Wolfe line search with one reduction per test.
+   *
+   * Same bracketing as MinimizerBase::line_search, but the curvature test
+   * reduces the local ∇fᵀp (or the gradient itself with ShardedData), so
+   * each trial step costs at most two allreduce calls. Leaves the trial
+   * point and its gradient in the workspace.
+   */
+  double line_search(const V &x, double f_old, double grad_f_old,
+                     RefVecFun<V> &f, RefGradFun<V> &Gradient, double &f_new) {
+    const double inf = std::numeric_limits<double>::infinity();
+    double alpha_min = 0.0;
+    double alpha_max = inf;
+    double alpha = 1.0;
+
+    for (int i = 0; i < max_line_iters; ++i) {
+      _ws.x_new.noalias() = x + alpha * _ws.p;
+      f_new = f(_ws.x_new);
+
+      // Armijo (sufficient decrease) condition
+      if (f_new > f_old + c1 * alpha * grad_f_old) {
+        alpha_max = alpha;
+        alpha = rho * (alpha_min + alpha_max);
+        continue;
+      }
+
+      Gradient(_ws.x_new, _ws.grad_new);
+      _dots(0) = _ws.grad_new.dot(_ws.p);
+      reduce_dots(1);
+
+      // Curvature condition
+      if (_dots(0) < c2 * grad_f_old) {
+        alpha_min = alpha;
+        alpha = alpha_max == inf ? 2 * alpha : rho * (alpha_min + alpha_max);
+        continue;
+      }
+      this->_line_search_converged = true;
+      return alpha;
+    }
+    // Fallback: If no alpha is found, return the last one
+    this->_line_search_converged = false;
+    ++this->_line_search_failures;
+    _ws.x_new.noalias() = x + alpha * _ws.p;
+    f_new = f(_ws.x_new);
+    Gradient(_ws.x_new, _ws.grad_new);
+    return alpha;
+  }
+
+  /**
+   * @brief keep_going() with agreement across ranks.
+   *
+   * The gradient norm, iteration and evaluation counts are identical on
+   * every rank; only the clock and the cancellation token are not, so the
+   * decision is reduced only when one of them is in use.
+   */
+  bool keep_going_collective(double grad_norm) {
+    bool go = this->keep_going(grad_norm);
+    if (!_termination.cancel && _termination.max_time.count() <= 0.0)
+      return go;
+
+    int code = go ? 0 : static_cast<int>(_status);
+    MPI_Allreduce(MPI_IN_PLACE, &code, 1, MPI_INT, MPI_MAX, _comm);
+    ++_allreduces;
+    if (code != 0)
+      _status = static_cast<SolverStatus>(code);
+    return code == 0;
+  }
+
+  MPI_Comm _comm;
+  DistributedLayout _layout;
+
+  /// Curvature pairs and temporaries, reused across solves of the same size.
+  LBFGSWorkspace<V> _ws{0, 0};
+  /// Gram matrix of {s_0..s_{m−1}, y_0..y_{m−1}, ∇f}, replicated on every rank.
+  Eigen::MatrixXd _G;
+  /// Coefficients of the two-loop vector in the basis.
+  Eigen::VectorXd _delta;
+  /// Send/receive buffer of the batched reductions.
+  Eigen::VectorXd _dots;
+
+  unsigned long _allreduces = 0;
+  double _comm_seconds = 0.0;
+};
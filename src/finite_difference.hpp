@@ -0,0 +1,268 @@
+#pragma once
+
+#include "common.hpp"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <eigen3/Eigen/Eigen>
+#include <limits>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Finite-difference scheme used by finiteDifferenceGradient().
+ */
+enum class FiniteDifferenceMode {
+  /// (f(x + h e_i) − f(x)) / h, n + 1 evaluations, O(h) error.
+  Forward,
+  /// (f(x + h e_i) − f(x − h e_i)) / 2h, 2n evaluations, O(h²) error.
+  Central,
+  /// Central differences with an adaptive step per coordinate (Ridders'
+  /// extrapolation): up to 20 evaluations per coordinate, error close to
+  /// the rounding level of f.
+  Adaptive
+};
+
+/// Objective extended to complex arguments, as required by the complex step.
+using ComplexVecFun = std::function<std::complex<double>(Eigen::VectorXcd)>;
+
+/**
+ * @brief Central difference of @p f along coordinate @p i with step @p h.
+ *
+ * @p xt is a copy of x, restored on return. The step is rounded so that
+ * x_i + h − x_i is exact.
+ */
+template <typename V>
+double centralDifference(const VecFun<V, double> &f, V &xt, Eigen::Index i, double h) {
+  const double xi = xt(i);
+  volatile double xh = xi + h;
+  h = xh - xi;
+  xt(i) = xi + h;
+  double f_plus = f(xt);
+  xt(i) = xi - h;
+  double f_minus = f(xt);
+  xt(i) = xi;
+  return (f_plus - f_minus) / (2.0 * h);
+}
+
+/**
+ * @brief Derivative along coordinate @p i by Ridders' extrapolation.
+ *
+ * Starts from a large step, shrinks it by a constant factor and
+ * extrapolates the central differences to h → 0 with a Neville tableau.
+ * The step is adapted to f: shrinking stops once the error estimate grows,
+ * i.e. when rounding starts to dominate truncation, and the estimate with
+ * the smallest error is returned.
+ */
+template <typename V>
+double riddersDerivative(const VecFun<V, double> &f, V &xt, Eigen::Index i) {
+  constexpr int ntab = 10;
+  constexpr double shrink = 1.4, shrink2 = shrink * shrink, safe = 2.0;
+  double a[ntab][ntab];
+
+  double h = 0.1 * std::max(std::abs(xt(i)), 1.0);
+  a[0][0] = centralDifference(f, xt, i, h);
+  double err = std::numeric_limits<double>::max();
+  double derivative = a[0][0];
+  for (int k = 1; k < ntab; ++k) {
+    h /= shrink;
+    a[0][k] = centralDifference(f, xt, i, h);
+    double fac = shrink2;
+    for (int j = 1; j <= k; ++j) {
+      a[j][k] = (a[j - 1][k] * fac - a[j - 1][k - 1]) / (fac - 1.0);
+      fac *= shrink2;
+      double err_k = std::max(std::abs(a[j][k] - a[j - 1][k]), std::abs(a[j][k] - a[j - 1][k - 1]));
+      if (err_k <= err) {
+        err = err_k;
+        derivative = a[j][k];
+      }
+    }
+    if (std::abs(a[k][k] - a[k - 1][k - 1]) >= safe * err)
+      break;
+  }
+  return derivative;
+}
+
+/**
+ * @brief Build a finite-difference gradient of @p f.
+ *
+ * For the Forward and Central modes the step of each coordinate is fixed
+ * and scaled with the magnitude of x_i,
+ *      h_i = ε^{1/2} max(|x_i|, 1)   (forward)
+ *      h_i = ε^{1/3} max(|x_i|, 1)   (central)
+ * which balances truncation and rounding error when f is computed to
+ * machine precision and its derivatives are of the order of f. It is
+ * rounded so that x_i + h_i − x_i is exact. The Adaptive mode instead
+ * chooses the step of each coordinate from the behaviour of f, see
+ * riddersDerivative(), for functions that are badly scaled or noisier than
+ * ε, at several times the cost. The probes are distributed over OpenMP
+ * threads, each working on its own copy of x: @p f must be safe to call
+ * concurrently.
+ *
+ * The complex step is not one of the modes: it evaluates f at complex
+ * points, so it needs an f of a different type (see complexStepGradient()).
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @param f Objective function.
+ * @param mode Finite-difference scheme.
+ * @return Gradient function usable with MinimizerBase::solve.
+ */
+template <typename V>
+GradFun<V> finiteDifferenceGradient(VecFun<V, double> f,
+                                    FiniteDifferenceMode mode = FiniteDifferenceMode::Central) {
+  return [f, mode](V x) {
+    const Eigen::Index n = x.size();
+    const double eps = std::numeric_limits<double>::epsilon();
+    const bool central = mode == FiniteDifferenceMode::Central;
+    const double scale = central ? std::cbrt(eps) : std::sqrt(eps);
+    const double f0 = mode == FiniteDifferenceMode::Forward ? f(x) : 0.0;
+    V g(n);
+
+#pragma omp parallel
+    {
+      V xt = x;
+#pragma omp for schedule(static)
+      for (Eigen::Index i = 0; i < n; ++i) {
+        if (mode == FiniteDifferenceMode::Adaptive) {
+          g(i) = riddersDerivative(f, xt, i);
+          continue;
+        }
+
+        volatile double xh = x(i) + scale * std::max(std::abs(x(i)), 1.0);
+        double h = xh - x(i);
+
+        xt(i) = x(i) + h;
+        double f_plus = f(xt);
+        if (central) {
+          xt(i) = x(i) - h;
+          g(i) = (f_plus - f(xt)) / (2.0 * h);
+        } else {
+          g(i) = (f_plus - f0) / h;
+        }
+        xt(i) = x(i);
+      }
+    }
+    return g;
+  };
+}
+
+/**
+ * @brief Build a complex-step gradient of @p f.
+ *
+ * Uses ∂f/∂x_i ≈ Im f(x + i h e_i) / h, which has no subtractive
+ * cancellation: with h = 1e-20 the result is exact to machine precision.
+ * Requires @p f to be written for complex arguments (analytic extension,
+ * no abs/max on the variables). Probes run on OpenMP threads as in
+ * finiteDifferenceGradient().
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @param f Objective function accepting complex vectors.
+ * @return Gradient function usable with MinimizerBase::solve.
+ */
+template <typename V>
+GradFun<V> complexStepGradient(ComplexVecFun f) {
+  return [f](V x) {
+    const Eigen::Index n = x.size();
+    const double h = 1.e-20;
+    V g(n);
+
+#pragma omp parallel
+    {
+      Eigen::VectorXcd xt = x.template cast<std::complex<double>>();
+#pragma omp for schedule(static)
+      for (Eigen::Index i = 0; i < n; ++i) {
+        xt(i) = std::complex<double>(x(i), h);
+        g(i) = f(xt).imag() / h;
+        xt(i) = x(i);
+      }
+    }
+    return g;
+  };
+}
+
+/**
+ * @brief Outcome of gradientCheck().
+ */
+struct GradientCheckResult {
+  /// Largest relative error between ∇f·d and the finite difference along d.
+  double max_relative_error = 0.0;
+  /// Index of the sampled direction attaining the largest error.
+  int worst_sample = -1;
+  /// Whether max_relative_error is below the requested tolerance.
+  bool passed = true;
+};
+
+/**
+ * @brief Validate a user gradient against directional finite differences.
+ *
+ * Draws @p samples random unit directions d and compares ∇f(x)·d with the
+ * central difference (f(x + h d) − f(x − h d)) / 2h. Costs one gradient and
+ * 2 * samples function evaluations instead of the 2n of a full
+ * finite-difference gradient; directions are evaluated in parallel.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @param f Objective function.
+ * @param Gradient Gradient function to validate.
+ * @param x Point where the gradient is checked.
+ * @param samples Number of random directions.
+ * @param tol Tolerance on the relative error.
+ * @param seed Seed of the direction generator.
+ */
+template <typename V>
+GradientCheckResult gradientCheck(VecFun<V, double> &f, GradFun<V> &Gradient, const V &x,
+                                  int samples = 8, double tol = 1.e-6, unsigned int seed = 42) {
+  const Eigen::Index n = x.size();
+  const double eps = std::numeric_limits<double>::epsilon();
+  const double h = std::cbrt(eps) * std::max(1.0, x.template lpNorm<Eigen::Infinity>());
+  V g = Gradient(x);
+
+  std::mt19937 gen(seed);
+  std::normal_distribution<double> normal;
+  std::vector<V> dirs(samples, V(n));
+  for (V &d : dirs) {
+    for (Eigen::Index i = 0; i < n; ++i)
+      d(i) = normal(gen);
+    d.normalize();
+  }
+
+  std::vector<double> errors(samples);
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < samples; ++k) {
+    double analytic = g.dot(dirs[k]);
+    double numeric = (f(x + h * dirs[k]) - f(x - h * dirs[k])) / (2.0 * h);
+    double scale = std::max({std::abs(analytic), std::abs(numeric), std::sqrt(eps)});
+    errors[k] = std::abs(analytic - numeric) / scale;
+  }
+
+  GradientCheckResult result;
+  for (int k = 0; k < samples; ++k) {
+    if (errors[k] > result.max_relative_error) {
+      result.max_relative_error = errors[k];
+      result.worst_sample = k;
+    }
+  }
+  result.passed = result.max_relative_error <= tol;
+  return result;
+}
+
+/**
+ * @brief Debug-only gradient check.
+ *
+ * Runs gradientCheck() and aborts through the check macro on mismatch.
+ * Compiles to nothing when NDEBUG is defined, so it can be left in front of
+ * production solves.
+ */
+template <typename V>
+void debugGradientCheck(VecFun<V, double> &f, GradFun<V> &Gradient, const V &x,
+                        int samples = 8, double tol = 1.e-6) {
+#ifndef NDEBUG
+  GradientCheckResult result = gradientCheck(f, Gradient, x, samples, tol);
+  check(result.passed, "gradient does not match finite differences");
+#else
+  (void)f;
+  (void)Gradient;
+  (void)x;
+  (void)samples;
+  (void)tol;
+#endif
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "common.hpp"
+#include <algorithm>
+#include <eigen3/Eigen/Eigen>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Fused value/gradient evaluator for finite-sum objectives.
+ *
+ * Builds the objective
+ *      f(x) = Σ_i f_i(x)
+ * from a kernel evaluating a contiguous block of terms [begin, end). Blocks
+ * are evaluated in parallel (OpenMP), each one accumulating into its own
+ * preallocated gradient buffer, and the partial results are combined by a
+ * pairwise tree reduction. The block partition depends only on the number
+ * of terms and of blocks, and the default number of blocks (default_blocks)
+ * is a constant, so results are bitwise reproducible regardless of the
+ * number of threads or of the scheduling.
+ *
+ * The callables returned by function() and gradient() share a one-point
+ * cache: the usual f(x) followed by ∇f(x) on the same point costs a single
+ * pass over the terms. The cache is guarded by a mutex, so the callables may
+ * be called concurrently (e.g. by the speculative line search), although
+ * such calls are serialized.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ */
+template <typename V>
+class FiniteSum {
+public:
+  /**
+   * @brief Kernel evaluating the terms in [begin, end).
+   *
+   * Must return Σ f_i(x) over the block and add Σ ∇f_i(x) into @p g
+   * (which is zeroed beforehand). Called concurrently on disjoint blocks.
+   */
+  using BlockKernel = std::function<double(const V &x, Eigen::Index begin, Eigen::Index end, V &g)>;
+
+  /**
+   * @brief Kernel evaluating a single term i.
+   *
+   * Must return f_i(x) and add ∇f_i(x) into @p g.
+   */
+  using TermKernel = std::function<double(const V &x, Eigen::Index i, V &g)>;
+
+  /**
+   * @brief Number of blocks used when none is given.
+   *
+   * Fixed rather than taken from the thread count, which would change the
+   * summation order; large enough to balance the load on common core counts,
+   * at the price of one gradient buffer per block.
+   */
+  static constexpr int default_blocks = 64;
+
+  /**
+   * @brief Build the objective from a block kernel.
+   *
+   * @param terms Number of terms in the sum.
+   * @param kernel Block kernel.
+   * @param blocks Number of blocks (0 means default_blocks).
+   */
+  FiniteSum(Eigen::Index terms, BlockKernel kernel, int blocks = 0)
+      : _state(std::make_shared<State>()) {
+    check((terms > 0), "finite sum must have at least one term");
+    _state->terms = terms;
+    _state->kernel = std::move(kernel);
+    _state->blocks = static_cast<Eigen::Index>(blocks > 0 ? blocks : default_blocks);
+    _state->blocks = std::min(_state->blocks, terms);
+  }
+
+  /**
+   * @brief Build the objective from a per-term kernel.
+   *
+   * @param terms Number of terms in the sum.
+   * @param kernel Term kernel.
+   * @param blocks Number of blocks (0 means default_blocks).
+   */
+  static FiniteSum fromTerms(Eigen::Index terms, TermKernel kernel, int blocks = 0) {
+    BlockKernel block = [kernel](const V &x, Eigen::Index begin, Eigen::Index end, V &g) {
+      double val = 0.0;
+      for (Eigen::Index i = begin; i < end; ++i)
+        val += kernel(x, i, g);
+      return val;
+    };
+    return FiniteSum(terms, std::move(block), blocks);
+  }
+
+  /**
+   * @brief Evaluate f(x) and ∇f(x) in a single parallel pass.
+   *
+   * @param x Point of evaluation.
+   * @param g Output gradient.
+   * @return Value f(x).
+   */
+  double evaluate(const V &x, V &g) const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    _state->evaluate(x);
+    g = _state->buffers[0];
+    return _state->values[0];
+  }
+
+  /// Objective callable, compatible with MinimizerBase::solve.
+  VecFun<V, double> function() const {
+    std::shared_ptr<State> state = _state;
+    return [state](V x) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->evaluate(x);
+      return state->values[0];
+    };
+  }
+
+  /// Gradient callable, compatible with MinimizerBase::solve.
+  GradFun<V> gradient() const {
+    std::shared_ptr<State> state = _state;
+    return [state](V x) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->evaluate(x);
+      return state->buffers[0];
+    };
+  }
+
+private:
+  /// Evaluation state shared by the callables handed to the minimizers.
+  struct State {
+    Eigen::Index terms = 0;
+    Eigen::Index blocks = 1;
+    BlockKernel kernel;
+
+    /// Per-block partial gradients; buffers[0] holds the reduced result.
+    std::vector<V> buffers;
+    /// Per-block partial values; values[0] holds the reduced result.
+    std::vector<double> values;
+
+    /// Point of the cached evaluation.
+    V x_cached;
+    bool valid = false;
+
+    /// Serializes concurrent evaluations sharing the buffers.
+    std::mutex mutex;
+
+    void evaluate(const V &x) {
+      if (valid && x_cached.size() == x.size() && x_cached == x)
+        return;
+
+      if (buffers.size() != static_cast<size_t>(blocks) || buffers[0].size() != x.size()) {
+        buffers.assign(blocks, V::Zero(x.size()));
+        values.assign(blocks, 0.0);
+      }
+
+#pragma omp parallel for schedule(static)
+      for (Eigen::Index b = 0; b < blocks; ++b) {
+        Eigen::Index begin = b * terms / blocks;
+        Eigen::Index end = (b + 1) * terms / blocks;
+        buffers[b].setZero();
+        values[b] = kernel(x, begin, end, buffers[b]);
+      }
+
+      // Pairwise tree reduction into block 0, fixed order
+      for (Eigen::Index stride = 1; stride < blocks; stride *= 2) {
+#pragma omp parallel for schedule(static)
+        for (Eigen::Index b = 0; b < blocks - stride; b += 2 * stride) {
+          buffers[b] += buffers[b + stride];
+          values[b] += values[b + stride];
+        }
+      }
+
+      x_cached = x;
+      valid = true;
+    }
+  };
+
+  std::shared_ptr<State> _state;
+};
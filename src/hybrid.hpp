@@ -0,0 +1,349 @@
+#pragma once
+
+#include "bfgs.hpp"
+#include "common.hpp"
+#include "lbfgs.hpp"
+#include "minimizer_base.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <eigen3/Eigen/Eigen>
+#include <eigen3/Eigen/Sparse>
+#include <limits>
+#include <type_traits>
+
+/// Direct solver used for Newton steps: sparse or dense LDLᵀ.
+template <typename M>
+using DirectSolverT = typename std::conditional<
+    isSparse<M>,
+    Eigen::SimplicialLDLT<M>,
+    Eigen::LDLT<M>>::type;
+
+/**
+ * @brief Switching rules of HybridNewton.
+ */
+struct HybridPolicy {
+  /// Number of recent L-BFGS iterations used to estimate the convergence
+  /// rate and the curvature consistency.
+  unsigned int window = 5;
+
+  /// Largest relative error of the quadratic model over the window for the
+  /// iterate to count as inside the quadratic basin (see HybridNewton).
+  double curvature_tolerance = 1.e-3;
+
+  /// Cost of a Newton iteration relative to an L-BFGS iteration, used
+  /// until a Newton iteration has been timed. 0 estimates it from the
+  /// dimension for a dense Hessian (see HybridNewton); set it explicitly
+  /// for sparse Hessians, or when evaluating H dominates the cost.
+  double newton_cost_estimate = 0.0;
+
+  /// A Newton step stalls when it reduces ‖∇f‖ by less than this factor.
+  double stall_ratio = 0.5;
+
+  /// L-BFGS iterations after a stall before Newton is considered again.
+  unsigned int cooldown = 10;
+
+  /// Solve the Newton system by truncated CG on the Hessian (Newton-CG)
+  /// instead of factorizing it.
+  bool newton_cg = false;
+};
+
+/**
+ * @brief Hybrid minimizer running L-BFGS far from the solution and Newton
+ * steps near it.
+ *
+ * Starts with L-BFGS iterations and, over the last HybridPolicy::window of
+ * them, monitors
+ *  - the linear convergence rate r of ‖∇f‖ (geometric mean of the ratios
+ *    ‖∇f_{k+1}‖ / ‖∇f_k‖), which must be below 1, with unit steps accepted
+ *    by the line search at every iteration;
+ *  - the consistency of the curvature: every step must have yᵀs > 0 and
+ *    satisfy f_{k+1} − f_k ≈ ½ (∇f_k + ∇f_{k+1})ᵀ s_k (exact on quadratics)
+ *    within HybridPolicy::curvature_tolerance.
+ *
+ * When the iterate looks quadratic, the time left is predicted for both
+ * methods from the measured wall time of their iterations: L-BFGS needs
+ * log(tol / ‖∇f‖) / log(r) more iterations, Newton (one digit on the first
+ * step, doubling afterwards) about 1 + log2(log10(‖∇f‖ / tol)). Newton
+ * steps (H p = −∇f with a direct solver, or truncated CG) are taken if they
+ * are predicted to be faster. Until a Newton iteration has been timed, its
+ * cost is HybridPolicy::newton_cost_estimate L-BFGS iterations; by default
+ *      1 + n² / (12 m),
+ * the flops of a dense LDLᵀ factorization (n³/3) over those of the
+ * two-loop recursion (4mn) with memory m, or 10 for a sparse Hessian,
+ * whose factorization cost depends on its fill-in. A Newton step that
+ * fails, is not a descent direction or reduces ‖∇f‖ by less than
+ * HybridPolicy::stall_ratio returns the solver to L-BFGS for
+ * HybridPolicy::cooldown iterations. Newton steps also feed the L-BFGS
+ * memory, so a fall back resumes with a warm history.
+ *
+ * Requires a Hessian set with setHessian().
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type of the Hessian, dense or sparse.
+ * @tparam Solver Direct solver for the Newton system.
+ */
+template <typename V, typename M, typename Solver = DirectSolverT<M>>
+class HybridNewton : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_hessFun;
+  using Base::_iters;
+  using Base::_tol;
+  using Base::alpha_wolfe;
+  using Base::m;
+
+  using clock = std::chrono::steady_clock;
+
+public:
+  /**
+   * @brief Set the switching rules.
+   */
+  void setPolicy(const HybridPolicy &policy) noexcept { _policy = policy; }
+
+  /// Get the switching rules in use.
+  const HybridPolicy &policy() const noexcept { return _policy; }
+
+  /// Number of Newton iterations in the last solve().
+  unsigned int newtonIterations() const noexcept { return _newton_iters; }
+
+  /// Number of switches from L-BFGS to Newton in the last solve().
+  unsigned int switches() const noexcept { return _switches; }
+
+  /// Number of falls back from Newton to L-BFGS in the last solve().
+  unsigned int fallbacks() const noexcept { return _fallbacks; }
+
+  /**
+   * @brief Run the hybrid method.
+   *
+   * @param x Initial guess (passed by value).
+   * @param f Objective function.
+   * @param Gradient Gradient function.
+   * @return Approximate minimizer.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    check(static_cast<bool>(_hessFun), "HybridNewton requires a Hessian (setHessian)");
+
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
+
+    LBFGSWorkspace<V> ws(x.size(), m);
+    _newton = false;
+    _newton_iters = 0;
+    _switches = 0;
+    _fallbacks = 0;
+    _wait = 0;
+    _qn_seconds = 0.0;
+    _newton_seconds = 0.0;
+    _newton_cost = _policy.newton_cost_estimate > 0.0 ? _policy.newton_cost_estimate
+                                                      : default_newton_cost(x.size());
+    _window.clear();
+
+    double fx = f_counted(x);
+    grad_counted(x, ws.grad);
+
+    for (_iters = 0; this->keep_going(ws.grad.norm()); ++_iters) {
+      const clock::time_point start = clock::now();
+      const double g_norm = ws.grad.norm();
+
+      bool newton_step = _newton && newton_direction(x, ws);
+      if (_newton && !newton_step)
+        fall_back();
+      if (!newton_step)
+        LBFGS<V, M>::compute_direction(ws);
+
+      double f_new;
+      alpha_wolfe = this->line_search(x, ws.p, fx, ws.grad.dot(ws.p), f_counted, grad_counted,
+                                      ws.x_new, f_new, ws.grad_new);
+
+      // Store curvature pair (s_k, y_k), overwriting the oldest if full
+      size_t k = ws.count < ws.capacity() ? ws.slot(ws.count) : ws.head;
+      ws.s[k].noalias() = ws.x_new - x;
+      ws.y[k].noalias() = ws.grad_new - ws.grad;
+      ws.rho[k] = 1.0 / ws.y[k].dot(ws.s[k]);
+      if (ws.count < ws.capacity())
+        ++ws.count;
+      else
+        ws.head = (ws.head + 1) % ws.capacity();
+
+      // Relative error of the quadratic model along the step
+      double df = f_new - fx;
+      double model_error = std::abs(df - 0.5 * (ws.grad + ws.grad_new).dot(ws.s[k])) /
+                           std::max(std::abs(df), std::numeric_limits<double>::min());
+      bool positive_curvature = ws.y[k].dot(ws.s[k]) > 0.0;
+
+      this->check_step(fx, f_new, ws.s[k].norm(), x.norm());
+
+      x = ws.x_new;
+      ws.grad.swap(ws.grad_new);
+      fx = f_new;
+
+      double seconds = std::chrono::duration<double>(clock::now() - start).count();
+      if (newton_step)
+        after_newton_step(g_norm, ws.grad.norm(), seconds);
+      else
+        after_lbfgs_step({ws.grad.norm() / g_norm,
+                          positive_curvature ? model_error : std::numeric_limits<double>::infinity(),
+                          alpha_wolfe == 1.0 && this->_line_search_converged},
+                         ws.grad.norm(), seconds);
+    }
+
+    return x;
+  }
+
+private:
+  /// Measurements of one L-BFGS iteration.
+  struct Sample {
+    double rate;        ///< ‖∇f_{k+1}‖ / ‖∇f_k‖
+    double model_error; ///< Relative error of the quadratic model (∞ if yᵀs <= 0).
+    bool unit_step;     ///< Whether the line search accepted alpha = 1.
+  };
+
+  /// Cost of a Newton iteration in L-BFGS iterations, from the dimension.
+  double default_newton_cost(Eigen::Index n) const {
+    if constexpr (isSparse<M>) {
+      return 10.0;
+    } else {
+      const double dim = static_cast<double>(n);
+      return 1.0 + dim * dim / (12.0 * static_cast<double>(m));
+    }
+  }
+
+  /// Exponential moving average of iteration times.
+  static double average(double avg, double seconds) {
+    return avg > 0.0 ? 0.7 * avg + 0.3 * seconds : seconds;
+  }
+
+  /// Record an L-BFGS iteration and switch to Newton if predicted faster.
+  void after_lbfgs_step(const Sample &sample, double g_new, double seconds) {
+    _qn_seconds = average(_qn_seconds, seconds);
+    _window.push_back(sample);
+    if (_window.size() > _policy.window)
+      _window.pop_front();
+
+    if (_wait > 0) {
+      --_wait;
+      return;
+    }
+    if (_window.size() < _policy.window || !(g_new > _tol))
+      return;
+
+    double log_rate = 0.0;
+    for (const Sample &s : _window) {
+      if (!(s.unit_step && s.model_error <= _policy.curvature_tolerance))
+        return;
+      log_rate += std::log(s.rate);
+    }
+    log_rate /= static_cast<double>(_window.size());
+    if (!(log_rate < 0.0))
+      return;
+
+    // Remaining iterations: L-BFGS at the observed linear rate, Newton
+    // gaining one digit on the first step and doubling them afterwards
+    double digits = std::log10(g_new / _tol);
+    double qn_iters = std::log(_tol / g_new) / log_rate;
+    double newton_iters = 1.0 + std::ceil(std::log2(std::max(digits, 1.0)));
+
+    double newton_seconds = _newton_seconds > 0.0 ? _newton_seconds
+                                                  : _newton_cost * _qn_seconds;
+    if (newton_iters * newton_seconds < qn_iters * _qn_seconds) {
+      _newton = true;
+      ++_switches;
+    }
+  }
+
+  /// Record a Newton iteration and fall back to L-BFGS if it stalled.
+  void after_newton_step(double g_old, double g_new, double seconds) {
+    ++_newton_iters;
+    _newton_seconds = average(_newton_seconds, seconds);
+    if (!(g_new <= _policy.stall_ratio * g_old) && g_new > _tol)
+      fall_back();
+  }
+
+  void fall_back() {
+    _newton = false;
+    ++_fallbacks;
+    _wait = _policy.cooldown;
+    _window.clear();
+  }
+
+  /**
+   * @brief Newton direction into ws.p.
+   *
+   * @return false if the system could not be solved or the result is not a
+   *         descent direction.
+   */
+  bool newton_direction(const V &x, LBFGSWorkspace<V> &ws) {
+    M H = _hessFun(x);
+    check((H.rows() == H.cols() && H.rows() == x.size()), "Hessian/gradient size mismatch");
+
+    if (_policy.newton_cg) {
+      newton_cg(H, ws.grad, ws.p);
+    } else {
+      _solver.compute(H);
+      if (_solver.info() != Eigen::Success)
+        return false;
+      ws.p = _solver.solve(-ws.grad);
+      if (_solver.info() != Eigen::Success)
+        return false;
+    }
+    return ws.p.dot(ws.grad) < 0.0 && ws.p.allFinite();
+  }
+
+  /**
+   * @brief Truncated CG on H p = −g.
+   *
+   * Stops at the forcing tolerance min(0.5, sqrt‖g‖)‖g‖ or on the first
+   * direction of nonpositive curvature, keeping the last iterate (−g if it
+   * happens on the first iteration).
+   */
+  static void newton_cg(const M &H, const V &g, V &p) {
+    const double g_norm = g.norm();
+    const double eps = std::min(0.5, std::sqrt(g_norm)) * g_norm;
+
+    p.setZero(g.size());
+    V r = g;
+    V d = -r;
+    double rr = r.dot(r);
+
+    for (Eigen::Index j = 0; j < g.size(); ++j) {
+      V Hd = H * d;
+      double dHd = d.dot(Hd);
+      if (dHd <= 0.0) {
+        if (j == 0)
+          p = -g;
+        return;
+      }
+
+      double a = rr / dHd;
+      p += a * d;
+      r += a * Hd;
+      double rr_next = r.dot(r);
+      if (std::sqrt(rr_next) < eps)
+        return;
+
+      d = -r + (rr_next / rr) * d;
+      rr = rr_next;
+    }
+  }
+
+  HybridPolicy _policy;
+  Solver _solver;
+
+  /// Whether the solver is in the Newton phase.
+  bool _newton = false;
+  /// L-BFGS iterations left before Newton may be considered again.
+  unsigned int _wait = 0;
+  /// Recent L-BFGS iterations.
+  std::deque<Sample> _window;
+  /// Moving averages of the wall time of L-BFGS and Newton iterations.
+  double _qn_seconds = 0.0;
+  double _newton_seconds = 0.0;
+  /// Newton cost estimate of the current solve, in L-BFGS iterations.
+  double _newton_cost = 0.0;
+
+  unsigned int _newton_iters = 0;
+  unsigned int _switches = 0;
+  unsigned int _fallbacks = 0;
+};
@@ -5,6 +5,55 @@
 #include <eigen3/Eigen/Eigen>
 #include <autodiff/forward/dual.hpp>
 
+/**
+ * @brief Preallocated storage for LBFGS.
+ *
+ * Holds the curvature pairs in a ring buffer together with every temporary
+ * vector used by the iteration. Create it once for a given problem size and
+ * memory, and reuse it across solves: the in-place LBFGS::solve does not
+ * allocate after construction.
+ *
+ * @tparam V Vector type (e.g., Eigen::VectorXd).
+ */
+template <typename V>
+class LBFGSWorkspace {
+public:
+  /**
+   * @param n Problem size.
+   * @param m Number of stored curvature pairs.
+   */
+  LBFGSWorkspace(Eigen::Index n, size_t m)
+      : s(m, V::Zero(n)), y(m, V::Zero(n)), rho(m), alpha(m),
+        grad(n), grad_new(n), p(n), x_new(n) {}
+
+  /// Problem size this workspace was created for.
+  Eigen::Index size() const noexcept { return grad.size(); }
+
+  /// Number of pairs the ring buffer can hold.
+  size_t capacity() const noexcept { return s.size(); }
+
+  /// Forget the stored curvature pairs.
+  void clear() noexcept {
+    head = 0;
+    count = 0;
+  }
+
+  /// Storage slot of the i-th oldest stored pair.
+  size_t slot(size_t i) const noexcept { return (head + i) % capacity(); }
+
+  std::vector<V> s;          ///< Displacement vectors s_k = x_{k+1} − x_k.
+  std::vector<V> y;          ///< Gradient differences y_k = ∇f_{k+1} − ∇f_k.
+  std::vector<double> rho;   ///< Scalars ρ_k = 1 / (y_kᵀ s_k).
+  std::vector<double> alpha; ///< Coefficients of the two-loop recursion.
+  size_t head = 0;           ///< Slot of the oldest pair.
+  size_t count = 0;          ///< Number of stored pairs.
+
+  V grad;     ///< Current gradient.
+  V grad_new; ///< Gradient at the trial point.
+  V p;        ///< Search direction.
+  V x_new;    ///< Trial point.
+};
+
 /**
  * @brief Limited-memory BFGS (L-BFGS) minimizer.
  *
@@ -39,55 +88,66 @@ public:
    * @return The final estimate of the minimizer.
    */
   V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    RefVecFun<V> f_ref = [&f](const Eigen::Ref<const V> &v) { return f(v); };
+    RefGradFun<V> grad_ref = [&Gradient](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) { g = Gradient(v); };
 
-    std::vector<V> s_list;        ///< Stored displacement vectors s_k = x_{k+1} − x_k.
-    std::vector<V> y_list;        ///< Stored gradient differences y_k = ∇f_{k+1} − ∇f_k.
-    std::vector<double> rho_list; ///< Scalars ρ_k = 1 / (y_kᵀ s_k).
-
-    V grad = Gradient(x); ///< Current gradient.
-    V p = -grad;          ///< Initial descent direction.
-    V x_new = x;          ///< Updated point.
-
-    for (_iters = 0; _iters < _max_iters; ++_iters) {
-
-      // Stopping condition based on gradient norm
-      if (grad.norm() < _tol) {
-        break;
-      }
-
-      // Compute L-BFGS search direction
-      p = compute_direction(grad, s_list, y_list, rho_list);
-
-      // Wolfe line search to select step length
-      alpha_wolfe = this->line_search(x, p, f, Gradient);
-
-      // Point update
-      x_new = x + alpha_wolfe * p;
-      V s = x_new - x;
+    LBFGSWorkspace<V> ws(x.size(), m);
+    solve(x, f_ref, grad_ref, ws);
+    return x;
+  }
 
-      // Gradient update
-      V grad_new = Gradient(x_new);
-      V y = grad_new - grad;
+  /**
+   * @brief Zero-copy L-BFGS on a caller-owned parameter buffer.
+   *
+   * Works in place on @p x (e.g. an Eigen::Map over an external arena) and
+   * keeps all temporaries in @p ws. Provided that @p f and @p Gradient do
+   * not allocate themselves, no heap allocation happens during the solve.
+   *
+   * @param x Initial guess on input, final estimate on output.
+   * @param f Objective function on borrowed vectors.
+   * @param Gradient Function writing ∇f(x) into its second argument.
+   * @param ws Workspace sized for x.size(); its history is reset.
+   */
+  void solve(Eigen::Ref<V> x, RefVecFun<V> &f, RefGradFun<V> &Gradient, LBFGSWorkspace<V> &ws) {
+    check((ws.size() == x.size()), "workspace size does not match the problem size");
 
-      x = x_new;
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
 
-      // Store curvature pair (s_k, y_k)
-      double rho = 1.0 / y.dot(s);
-      s_list.push_back(s);
-      y_list.push_back(y);
-      rho_list.push_back(rho);
+    ws.clear();
+    double fx = f_counted(x);
+    grad_counted(x, ws.grad);
 
-      // Enforce memory limit m
-      if (s_list.size() > m) {
-        s_list.erase(s_list.begin());
-        y_list.erase(y_list.begin());
-        rho_list.erase(rho_list.begin());
-      }
+    // Stopping conditions: gradient norm, budgets and setTermination() tests
+    for (_iters = 0; this->keep_going(ws.grad.norm()); ++_iters) {
 
-      grad = grad_new;
+      // Compute L-BFGS search direction
+      compute_direction(ws);
+
+      // Wolfe line search to select step length; also leaves f and ∇f at
+      // the new point in the workspace
+      double f_new;
+      alpha_wolfe = this->line_search(x, ws.p, fx, ws.grad.dot(ws.p), f_counted, grad_counted,
+                                      ws.x_new, f_new, ws.grad_new);
+
+      // Store curvature pair (s_k, y_k), overwriting the oldest if full
+      size_t k = ws.count < ws.capacity() ? ws.slot(ws.count) : ws.head;
+      ws.s[k].noalias() = ws.x_new - x;
+      ws.y[k].noalias() = ws.grad_new - ws.grad;
+      ws.rho[k] = 1.0 / ws.y[k].dot(ws.s[k]);
+      if (ws.count < ws.capacity())
+        ++ws.count;
+      else
+        ws.head = (ws.head + 1) % ws.capacity();
+
+      this->check_step(fx, f_new, ws.s[k].norm(), x.norm());
+
+      // Point and gradient update
+      x = ws.x_new;
+      ws.grad.swap(ws.grad_new);
+      fx = f_new;
     }
-
-    return x;
   }
 
   /**
@@ -141,5 +201,46 @@ public:
     return -z;
   }
 
+  /**
+   * @brief Two-loop recursion on the workspace ring buffer.
+   *
+   * Same recursion as the overload above; reads ws.grad and the stored
+   * pairs and writes the search direction into ws.p without allocating.
+   * Static, so that other solvers keeping an L-BFGS memory can reuse it.
+   *
+   * @param ws Workspace holding the gradient and the curvature pairs.
+   */
+  static void compute_direction(LBFGSWorkspace<V> &ws) {
+    V &q = ws.p;
+    q = ws.grad;
+
+    // If no curvature information is available, fall back to steepest descent
+    if (ws.count == 0) {
+      q = -q;
+      return;
+    }
+
+    // First loop: backward pass
+    for (size_t i = ws.count; i-- > 0;) {
+      size_t k = ws.slot(i);
+      ws.alpha[k] = ws.rho[k] * ws.s[k].dot(q);
+      q -= ws.alpha[k] * ws.y[k];
+    }
+
+    // Scaling of the initial Hessian approximation H0 = γ I
+    size_t last = ws.slot(ws.count - 1);
+    q *= ws.s[last].dot(ws.y[last]) / ws.y[last].dot(ws.y[last]);
+
+    // Second loop: forward pass
+    for (size_t i = 0; i < ws.count; ++i) {
+      size_t k = ws.slot(i);
+      double beta = ws.rho[k] * ws.y[k].dot(q);
+      q += ws.s[k] * (ws.alpha[k] - beta);
+    }
+
+    // Final search direction
+    q = -q;
+  }
+
 private:
 };
@@ -0,0 +1,487 @@
+#pragma once
+
+#include "bfgs.hpp"
+#include "common.hpp"
+#include "minimizer_base.hpp"
+#include <algorithm>
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+#include <eigen3/Eigen/Sparse>
+#include <eigen3/Eigen/SparseQR>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Linear solver for the damped Gauss–Newton system of
+ * LevenbergMarquardt.
+ */
+enum class LeastSquaresSolve {
+  /// QR factorization of the augmented matrix [J; √λ I]; most accurate,
+  /// avoids squaring the condition number.
+  QR,
+  /// Cholesky factorization of JᵀJ + λI; cheapest for few parameters.
+  Cholesky,
+  /// LSQR iterations on the damped problem; only needs J·v and Jᵀ·u.
+  LSQR
+};
+
+/**
+ * @brief Gauss–Newton / Levenberg–Marquardt minimizer for nonlinear least
+ * squares.
+ *
+ * Minimizes f(x) = ½ ‖r(x)‖² for a residual r: ℝⁿ → ℝᵐ with Jacobian J.
+ * Each iteration solves
+ *      (JᵀJ + λ I) p = −Jᵀr
+ * and accepts the step if the gain ratio between the actual reduction and
+ * the one predicted by the model ½‖r + Jp‖² is positive. The damping λ is
+ * adapted with Nielsen's rule: it shrinks by up to a factor 3 after good
+ * steps and grows geometrically after rejected ones, moving continuously
+ * between Gauss–Newton (λ → 0) and short gradient steps (λ large).
+ *
+ * The Jacobian can be dense (J = Eigen::MatrixXd), sparse
+ * (J = Eigen::SparseMatrix<double>), or given only through the products
+ * J·v and Jᵀ·u, in which case LeastSquaresSolve::LSQR must be used. The
+ * Jacobian storage, the normal or augmented matrix and the factorizations
+ * are members reused across iterations and solves. Sparse matrices keep
+ * their structure and are only refilled while the pattern of J does not
+ * change; the pattern is analyzed again when it does.
+ *
+ * The least-squares structure comes from setResidual(): the f and Gradient
+ * arguments of the generic solve() are not used.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd); only used for the base class.
+ * @tparam J Jacobian type, dense or sparse.
+ */
+template <typename V, typename M, typename J = M>
+class LevenbergMarquardt : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_iters;
+  using Base::_status;
+  using Base::_tol;
+
+  static constexpr bool SparseJacobian = isSparse<J>;
+
+  using QRSolver = typename std::conditional<
+      SparseJacobian,
+      Eigen::SparseQR<J, Eigen::COLAMDOrdering<int>>,
+      Eigen::ColPivHouseholderQR<J>>::type;
+
+  using CholeskySolver = typename std::conditional<
+      SparseJacobian,
+      Eigen::SimplicialLLT<J>,
+      Eigen::LLT<J>>::type;
+
+public:
+  /**
+   * @param method Linear solver for the damped system.
+   */
+  explicit LevenbergMarquardt(LeastSquaresSolve method = LeastSquaresSolve::Cholesky)
+      : _method(method) {}
+
+  /**
+   * @brief Set the residual and its Jacobian matrix.
+   *
+   * @param residual Residual function r(x).
+   * @param jacobian Function returning J(x); if sparse, a fixed sparsity
+   *        pattern avoids rebuilding and reanalyzing the sparse matrices.
+   */
+  void setResidual(VecFun<V, V> residual, JacobianFun<V, J> jacobian) {
+    _residual = std::move(residual);
+    _jacobian = std::move(jacobian);
+    _jv = nullptr;
+    _jtv = nullptr;
+  }
+
+  /**
+   * @brief Set the residual and matrix-free Jacobian products.
+   *
+   * Requires LeastSquaresSolve::LSQR.
+   *
+   * @param residual Residual function r(x).
+   * @param jv Product (x, v) -> J(x) v.
+   * @param jtv Product (x, u) -> J(x)ᵀ u.
+   */
+  void setResidual(VecFun<V, V> residual, JacobianProductFun<V> jv, JacobianProductFun<V> jtv) {
+    _residual = std::move(residual);
+    _jacobian = nullptr;
+    _jv = std::move(jv);
+    _jtv = std::move(jtv);
+  }
+
+  /// Get the linear solver used for the damped system.
+  LeastSquaresSolve linearSolver() const noexcept { return _method; }
+
+  /**
+   * @brief Set the initial damping, relative to the largest diagonal entry
+   * of JᵀJ (to ‖Jᵀr‖² / ‖r‖² without an explicit Jacobian).
+   *
+   * Zero starts with undamped Gauss–Newton steps; damping is introduced
+   * on the first rejected step.
+   *
+   * @param tau Relative initial damping (default 1e-3).
+   */
+  void setInitialDamping(double tau) noexcept { _tau = tau; }
+
+  /// Damping λ at the end of the last solve().
+  double damping() const noexcept { return _lambda; }
+
+  /// Set the maximum number of LSQR iterations per step (0 means 2n).
+  void setMaxInnerIterations(int max_iters) noexcept { _max_inner_iters = max_iters; }
+
+  /// Number of LSQR iterations in the last solve().
+  long innerIterations() const noexcept { return _inner_iters; }
+
+  /**
+   * @brief Minimize ½‖r‖² for the residual given to setResidual().
+   *
+   * Only provided for the MinimizerBase interface: @p f and @p Gradient
+   * are ignored, and the objective always comes from setResidual(), which
+   * must have been called. Call solve(x) directly instead.
+   *
+   * @param x Initial guess (passed by value).
+   * @param f Ignored.
+   * @param Gradient Ignored.
+   * @return Approximate minimizer.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    (void)f;
+    (void)Gradient;
+    check(static_cast<bool>(_residual),
+          "LevenbergMarquardt ignores f and Gradient: call setResidual, then solve(x)");
+    return solve(std::move(x));
+  }
+
+  /**
+   * @brief Minimize ½‖r‖² for the residual given to setResidual().
+   *
+   * @param x Initial guess (passed by value).
+   * @return Approximate minimizer.
+   */
+  V solve(V x) {
+    check(static_cast<bool>(_residual), "setResidual must be called before solve");
+    check((matrix_free() ? _method == LeastSquaresSolve::LSQR : static_cast<bool>(_jacobian)),
+          "matrix-free Jacobians require LeastSquaresSolve::LSQR");
+
+    this->start_solve();
+    _inner_iters = 0;
+    _pattern_analyzed = false;
+
+    V r = evaluate_residual(x);
+    V g = evaluate_jacobian(x, r);
+    double fx = 0.5 * r.squaredNorm();
+    V p(x.size()), x_new(x.size()), r_new;
+
+    // Scale of JᵀJ, for the relative damping
+    double scale = matrix_free() ? g.squaredNorm() / std::max(r.squaredNorm(), std::numeric_limits<double>::min())
+                                 : column_norms().maxCoeff();
+    scale = std::max(scale, std::numeric_limits<double>::epsilon());
+    _lambda = _tau * scale;
+    double nu = 2.0;
+
+    for (_iters = 0; this->keep_going(g.norm()); ++_iters) {
+      bool solved = solve_damped(x, r, g, p);
+
+      double gain = -1.0;
+      double f_new = fx;
+      if (solved) {
+        x_new = x + p;
+        r_new = evaluate_residual(x_new);
+        f_new = 0.5 * r_new.squaredNorm();
+        // Reductions of f and of its Gauss–Newton model; ½(r − r')ᵀ(r + r')
+        // avoids the cancellation of f − f' near the solution
+        double actual = 0.5 * (r - r_new).dot(r + r_new);
+        double predicted = -g.dot(p) - 0.5 * jacobian_times(x, p).squaredNorm();
+        if (predicted > 0.0)
+          gain = actual / predicted;
+      }
+
+      if (gain > 0.0) {
+        this->check_step(fx, f_new, p.norm(), x.norm());
+        x.swap(x_new);
+        r.swap(r_new);
+        fx = f_new;
+        g = evaluate_jacobian(x, r);
+
+        _lambda *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * gain - 1.0, 3));
+        nu = 2.0;
+      } else {
+        // Damping too small: move toward short gradient steps
+        _lambda = _lambda > 0.0 ? _lambda * nu : 1.e-3 * scale;
+        nu *= 2.0;
+
+        if (!std::isfinite(_lambda) ||
+            (solved && p.norm() <= std::numeric_limits<double>::epsilon() * (x.norm() + 1.0)))
+          _status = SolverStatus::StepTolerance;
+      }
+    }
+
+    return x;
+  }
+
+private:
+  bool matrix_free() const noexcept { return !_jacobian; }
+
+  V evaluate_residual(const V &x) {
+    this->count_evaluation();
+    return _residual(x);
+  }
+
+  /**
+   * @brief Evaluate the Jacobian at @p x (stored in _J) and return the
+   * gradient Jᵀr. Also forms JᵀJ for the Cholesky solver.
+   */
+  V evaluate_jacobian(const V &x, const V &r) {
+    this->count_evaluation();
+    if (matrix_free())
+      return _jtv(x, r);
+
+    _J = _jacobian(x);
+    check((_J.rows() == r.size() && _J.cols() == x.size()), "Jacobian size mismatch");
+    if constexpr (SparseJacobian)
+      _J.makeCompressed();
+    if (_method == LeastSquaresSolve::Cholesky)
+      _normal = _J.transpose() * _J;
+    return _J.transpose() * r;
+  }
+
+  /// Product J(x) v, explicit or matrix-free.
+  V jacobian_times(const V &x, const V &v) const {
+    if (matrix_free())
+      return _jv(x, v);
+    return _J * v;
+  }
+
+  /// Squared column norms of J, i.e. the diagonal of JᵀJ.
+  V column_norms() const {
+    return _J.cwiseAbs2().transpose() * V::Ones(_J.rows());
+  }
+
+  /// Solve (JᵀJ + λI) p = −g with the configured method.
+  bool solve_damped(const V &x, const V &r, const V &g, V &p) {
+    switch (_method) {
+    case LeastSquaresSolve::QR:
+      return solve_qr(r, p);
+    case LeastSquaresSolve::Cholesky:
+      return solve_cholesky(g, p);
+    case LeastSquaresSolve::LSQR:
+      return solve_lsqr(x, r, g, p);
+    }
+    return false;
+  }
+
+  /// Whether two compressed sparse matrices have the same nonzero pattern.
+  static bool same_pattern(const J &a, const J &b) {
+    return a.rows() == b.rows() && a.cols() == b.cols() && a.nonZeros() == b.nonZeros() &&
+           std::equal(a.outerIndexPtr(), a.outerIndexPtr() + a.outerSize() + 1, b.outerIndexPtr()) &&
+           std::equal(a.innerIndexPtr(), a.innerIndexPtr() + a.nonZeros(), b.innerIndexPtr());
+  }
+
+  /// Whether _A has the pattern of [J; I] for the current (sparse) J.
+  bool augmented_pattern_matches() const {
+    const Eigen::Index m = _J.rows();
+    const Eigen::Index n = _J.cols();
+    if (_A.rows() != m + n || _A.cols() != n || _A.nonZeros() != _J.nonZeros() + n)
+      return false;
+    for (Eigen::Index k = 0; k < n; ++k) {
+      const int *col = _J.innerIndexPtr() + _J.outerIndexPtr()[k];
+      const int *col_end = _J.innerIndexPtr() + _J.outerIndexPtr()[k + 1];
+      if (_A.outerIndexPtr()[k] != _J.outerIndexPtr()[k] + k ||
+          !std::equal(col, col_end, _A.innerIndexPtr() + _A.outerIndexPtr()[k]))
+        return false;
+    }
+    return true;
+  }
+
+  /// Least-squares solution of [J; √λ I] p = [−r; 0].
+  bool solve_qr(const V &r, V &p) {
+    const Eigen::Index m = _J.rows();
+    const Eigen::Index n = _J.cols();
+    const double sqrt_lambda = std::sqrt(_lambda);
+
+    if constexpr (SparseJacobian) {
+      // Column k of A holds column k of J, then the diagonal entry (m + k, k).
+      // While the pattern of J does not change, only the values are refilled
+      if (augmented_pattern_matches()) {
+        double *values = _A.valuePtr();
+        const double *j_values = _J.valuePtr();
+        for (Eigen::Index k = 0; k < n; ++k) {
+          values = std::copy(j_values + _J.outerIndexPtr()[k], j_values + _J.outerIndexPtr()[k + 1], values);
+          *values++ = sqrt_lambda;
+        }
+      } else {
+        _triplets.clear();
+        for (Eigen::Index k = 0; k < _J.outerSize(); ++k)
+          for (typename J::InnerIterator it(_J, k); it; ++it)
+            _triplets.emplace_back(it.row(), it.col(), it.value());
+        for (Eigen::Index i = 0; i < n; ++i)
+          _triplets.emplace_back(m + i, i, sqrt_lambda);
+        _A.resize(m + n, n);
+        _A.setFromTriplets(_triplets.begin(), _triplets.end());
+        _A.makeCompressed();
+        _pattern_analyzed = false;
+      }
+
+      if (!_pattern_analyzed) {
+        _qr.analyzePattern(_A);
+        _pattern_analyzed = true;
+      }
+      _qr.factorize(_A);
+    } else {
+      _A.resize(m + n, n);
+      _A.topRows(m) = _J;
+      _A.bottomRows(n).setZero();
+      _A.bottomRows(n).diagonal().setConstant(sqrt_lambda);
+      _qr.compute(_A);
+    }
+    if (_qr.info() != Eigen::Success)
+      return false;
+
+    _b.resize(m + n);
+    _b.head(m) = -r;
+    _b.tail(n).setZero();
+    p = _qr.solve(_b);
+    return _qr.info() == Eigen::Success && p.allFinite();
+  }
+
+  /// Cholesky factorization of JᵀJ + λI.
+  bool solve_cholesky(const V &g, V &p) {
+    if constexpr (SparseJacobian) {
+      // While JᵀJ keeps its pattern, copy its values and shift the diagonal
+      // in place. If JᵀJ lacks a diagonal entry (empty column of J) the
+      // patterns never match and the sum is formed every time
+      if (same_pattern(_shifted, _normal)) {
+        std::copy(_normal.valuePtr(), _normal.valuePtr() + _normal.nonZeros(), _shifted.valuePtr());
+        for (Eigen::Index diag : _diagonal)
+          _shifted.valuePtr()[diag] += _lambda;
+      } else {
+        if (_identity.rows() != _normal.rows()) {
+          _identity.resize(_normal.rows(), _normal.cols());
+          _identity.setIdentity();
+        }
+        _shifted = _normal + _lambda * _identity;
+        _shifted.makeCompressed();
+        _diagonal.resize(_shifted.cols());
+        for (Eigen::Index k = 0; k < _shifted.cols(); ++k) {
+          const int *begin = _shifted.innerIndexPtr() + _shifted.outerIndexPtr()[k];
+          const int *end = _shifted.innerIndexPtr() + _shifted.outerIndexPtr()[k + 1];
+          _diagonal[k] = std::lower_bound(begin, end, k) - _shifted.innerIndexPtr();
+        }
+        _pattern_analyzed = false;
+      }
+      if (!_pattern_analyzed) {
+        _cholesky.analyzePattern(_shifted);
+        _pattern_analyzed = true;
+      }
+      _cholesky.factorize(_shifted);
+    } else {
+      _shifted = _normal;
+      _shifted.diagonal().array() += _lambda;
+      _cholesky.compute(_shifted);
+    }
+    if (_cholesky.info() != Eigen::Success)
+      return false;
+
+    p = _cholesky.solve(-g);
+    return p.allFinite();
+  }
+
+  /**
+   * @brief LSQR on min ‖J p + r‖² + λ‖p‖² (Paige & Saunders).
+   *
+   * Stops when the residual of the damped normal equations falls below
+   * η‖Jᵀr‖ with η = min(0.1, sqrt‖Jᵀr‖), the same forcing sequence as the
+   * inexact BFGS solves.
+   */
+  bool solve_lsqr(const V &x, const V &r, const V &g, V &p) {
+    auto Jt_times = [&](const V &u) -> V {
+      if (matrix_free())
+        return _jtv(x, u);
+      return _J.transpose() * u;
+    };
+
+    const double damp = std::sqrt(_lambda);
+    const double g_norm = g.norm();
+    const double eta = std::min(0.1, std::sqrt(g_norm));
+    const int max_iters = _max_inner_iters > 0 ? _max_inner_iters : 2 * static_cast<int>(x.size());
+
+    p.setZero(x.size());
+    V u = -r;
+    double beta = u.norm();
+    if (beta == 0.0)
+      return true;
+    u /= beta;
+    V v = Jt_times(u);
+    double alpha = v.norm();
+    if (alpha == 0.0)
+      return true;
+    v /= alpha;
+    V w = v;
+
+    double phibar = beta;
+    double rhobar = alpha;
+
+    for (int it = 0; it < max_iters; ++it, ++_inner_iters) {
+      // Bidiagonalization
+      u = jacobian_times(x, v) - alpha * u;
+      beta = u.norm();
+      if (beta > 0.0)
+        u /= beta;
+      v = Jt_times(u) - beta * v;
+      alpha = v.norm();
+      if (alpha > 0.0)
+        v /= alpha;
+
+      // Eliminate the damping term, then the subdiagonal
+      double rhobar1 = std::hypot(rhobar, damp);
+      double cs1 = rhobar / rhobar1;
+      phibar *= cs1;
+
+      double rho = std::hypot(rhobar1, beta);
+      double cs = rhobar1 / rho;
+      double sn = beta / rho;
+      double theta = sn * alpha;
+      rhobar = -cs * alpha;
+      double phi = cs * phibar;
+      phibar *= sn;
+
+      p += (phi / rho) * w;
+      w = v - (theta / rho) * w;
+
+      // ‖(JᵀJ + λI) p + Jᵀr‖ estimate
+      if (std::abs(phibar * alpha * cs) <= eta * g_norm || alpha == 0.0)
+        break;
+    }
+    return p.allFinite();
+  }
+
+  LeastSquaresSolve _method;
+  double _tau = 1.e-3;
+  double _lambda = 0.0;
+  int _max_inner_iters = 0;
+  long _inner_iters = 0;
+
+  VecFun<V, V> _residual;
+  JacobianFun<V, J> _jacobian;
+  JacobianProductFun<V> _jv;
+  JacobianProductFun<V> _jtv;
+
+  /// Jacobian at the current point.
+  J _J;
+  /// JᵀJ (Cholesky) and JᵀJ + λI.
+  J _normal;
+  J _shifted;
+  /// Sparse identity, for the shift of the sparse normal matrix.
+  J _identity;
+  /// Positions of the diagonal entries in _shifted.valuePtr().
+  std::vector<Eigen::Index> _diagonal;
+  /// Augmented matrix [J; √λ I] and right-hand side (QR).
+  J _A;
+  V _b;
+  std::vector<Eigen::Triplet<double>> _triplets;
+
+  QRSolver _qr;
+  CholeskySolver _cholesky;
+  bool _pattern_analyzed = false;
+};
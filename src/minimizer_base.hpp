@@ -1,9 +1,17 @@
 #pragma once
 
 #include "common.hpp"
+#include "termination.hpp"
 #include <eigen3/Eigen/Cholesky>
 #include <eigen3/Eigen/Eigen>
 #include <eigen3/Eigen/IterativeLinearSolvers>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <vector>
 
 /**
  * @brief Base class for iterative minimization algorithms.
@@ -55,6 +63,59 @@ public:
    */
   void setTolerance(double tol) noexcept { _tol = tol; }
 
+  /**
+   * @brief Set additional stopping tests and budgets.
+   *
+   * @param criteria Termination policy applied by every solve().
+   */
+  void setTermination(const TerminationCriteria &criteria) noexcept { _termination = criteria; }
+
+  /**
+   * @brief Get the termination policy in use.
+   */
+  const TerminationCriteria &termination() const noexcept { return _termination; }
+
+  /**
+   * @brief Get the reason why the last solve() stopped.
+   */
+  SolverStatus status() const noexcept { return _status; }
+
+  /**
+   * @brief Get the number of f and ∇f evaluations of the last solve().
+   */
+  unsigned long evaluations() const noexcept { return _evals; }
+
+  /**
+   * @brief Get the number of line searches of the last solve() that did
+   * not satisfy the Wolfe conditions.
+   */
+  unsigned int lineSearchFailures() const noexcept { return _line_search_failures; }
+
+  /**
+   * @brief Evaluate several trial steps of each line search concurrently.
+   *
+   * With @p trials > 1 the line search speculates on the step lengths it
+   * may need next (both outcomes of the current test, breadth first) and
+   * evaluates up to @p trials of them in parallel, each in its own
+   * workspace. The accepted step is the same one the sequential search
+   * would select, so iterates do not change; only the latency does, at
+   * the price of extra evaluations. @p f and ∇f must be safe to call
+   * concurrently. Values <= 1 restore the sequential search.
+   *
+   * @param trials Number of concurrent trial steps.
+   */
+  void setSpeculativeTrials(int trials) noexcept { _speculative_trials = std::max(1, trials); }
+
+  /**
+   * @brief Wall-clock time saved by each speculative line search of the
+   * last solve(), in seconds.
+   *
+   * Measured as the summed duration of the evaluations the sequential
+   * search would have performed, minus the wall time of the parallel
+   * batches. Negative entries mean the speculation did not pay off.
+   */
+  const std::vector<double> &lineSearchTimeSaved() const noexcept { return _time_saved; }
+
   /**
    * @brief Set the initial guess for the Hessian matrix
    *
@@ -92,6 +153,32 @@ protected:
   /// Tolerance used as stopping criterion.
   double _tol = 1.e-10;
 
+  /// Additional stopping tests and budgets.
+  TerminationCriteria _termination;
+
+  /// Reason why the last solve() stopped.
+  SolverStatus _status = SolverStatus::NotStarted;
+
+  /// Number of f and ∇f evaluations in the last solve(); incremented
+  /// through count_evaluation() by the counted() wrappers.
+  unsigned long _evals = 0;
+
+  /// Total and consecutive failed line searches in the last solve().
+  unsigned int _line_search_failures = 0;
+  unsigned int _consecutive_line_search_failures = 0;
+
+  /// Whether the last line search satisfied the Wolfe conditions.
+  bool _line_search_converged = true;
+
+  /// Start time of the last solve().
+  std::chrono::steady_clock::time_point _start;
+
+  /// Number of concurrent trial steps in the line search (1: sequential).
+  int _speculative_trials = 1;
+
+  /// Time saved by each speculative line search of the last solve().
+  std::vector<double> _time_saved;
+
   /// Hessian guess
   M _B;
 
@@ -118,6 +205,126 @@ protected:
   /// Contraction factor used when shrinking the step size.
   double rho = 0.5;
 
+  /**
+   * @brief Reset status, counters and clock; call at the start of solve().
+   */
+  void start_solve() {
+    _status = SolverStatus::Running;
+    _evals = 0;
+    _line_search_failures = 0;
+    _consecutive_line_search_failures = 0;
+    _line_search_converged = true;
+    _time_saved.clear();
+    _start = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * @brief Check the per-iteration stopping tests.
+   *
+   * Meant as the condition of the main loop: checks cancellation, gradient
+   * tolerance, iteration, time and evaluation budgets, and records the
+   * reason in @ref _status.
+   *
+   * @param grad_norm Norm of the current gradient.
+   * @return true if the solver should perform another iteration.
+   */
+  bool keep_going(double grad_norm) {
+    if (_status != SolverStatus::Running)
+      return false;
+
+    if (_termination.cancel && _termination.cancel->load(std::memory_order_relaxed))
+      _status = SolverStatus::Cancelled;
+    else if (!(grad_norm > _tol))
+      _status = SolverStatus::GradientTolerance;
+    else if (_iters >= _max_iters)
+      _status = SolverStatus::MaxIterations;
+    else if (_termination.max_evaluations > 0 && _evals >= _termination.max_evaluations)
+      _status = SolverStatus::EvaluationLimit;
+    else if (_termination.max_time.count() > 0.0 &&
+             std::chrono::steady_clock::now() - _start >= _termination.max_time)
+      _status = SolverStatus::TimeLimit;
+
+    return _status == SolverStatus::Running;
+  }
+
+  /**
+   * @brief Check the stopping tests that depend on the last step.
+   *
+   * Call after each accepted step: checks the relative decrease of f, the
+   * step length and the number of consecutive line-search failures.
+   *
+   * @param f_old Value before the step.
+   * @param f_new Value after the step.
+   * @param step_norm Norm of the step x_{k+1} − x_k.
+   * @param x_norm Norm of x_k.
+   * @return true if the solver should continue.
+   */
+  bool check_step(double f_old, double f_new, double step_norm, double x_norm) {
+    if (_line_search_converged)
+      _consecutive_line_search_failures = 0;
+    else
+      ++_consecutive_line_search_failures;
+
+    if (_termination.max_line_search_failures > 0 &&
+        _consecutive_line_search_failures >= _termination.max_line_search_failures)
+      _status = SolverStatus::LineSearchFailed;
+    else if (_termination.function_tolerance > 0.0 &&
+             std::abs(f_old - f_new) <= _termination.function_tolerance * std::max(std::abs(f_old), 1.0))
+      _status = SolverStatus::FunctionTolerance;
+    else if (_termination.step_tolerance > 0.0 &&
+             step_norm <= _termination.step_tolerance * std::max(x_norm, 1.0))
+      _status = SolverStatus::StepTolerance;
+
+    return _status == SolverStatus::Running;
+  }
+
+  /**
+   * @brief Count one evaluation of f or ∇f.
+   *
+   * The update is an OpenMP atomic, since the speculative line search
+   * evaluates trial steps concurrently; a plain counter keeps the solvers
+   * copyable.
+   */
+  void count_evaluation() noexcept {
+#pragma omp atomic
+    ++_evals;
+  }
+
+  /**
+   * @brief Wrap a value-based objective for the in-place routines,
+   * counting its evaluations against the budget.
+   */
+  RefVecFun<V> counted(VecFun<V, double> &f) {
+    return [this, &f](const Eigen::Ref<const V> &v) {
+      count_evaluation();
+      return f(v);
+    };
+  }
+
+  /// @copydoc counted(VecFun<V, double> &)
+  RefGradFun<V> counted(GradFun<V> &Gradient) {
+    return [this, &Gradient](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) {
+      count_evaluation();
+      g = Gradient(v);
+    };
+  }
+
+  /// @copydoc counted(VecFun<V, double> &)
+  RefVecFun<V> counted(RefVecFun<V> &f) {
+    return [this, &f](const Eigen::Ref<const V> &v) {
+      count_evaluation();
+      return f(v);
+    };
+  }
+
+  /// @copydoc counted(VecFun<V, double> &)
+  RefGradFun<V> counted(RefGradFun<V> &Gradient) {
+    return [this, &Gradient](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) {
+      count_evaluation();
+      Gradient(v, g);
+    };
+  }
+
   /**
    * @brief Perform a line search to find a suitable step length alpha.
    *
@@ -136,9 +343,45 @@ protected:
    *         is found within @ref max_line_iters, the last tested alpha is
    *         returned as a fallback.
    */
-  double line_search(V x, V p, VecFun<V, double> &f, GradFun<V> &Gradient) {
-    double f_old = f(x);
-    double grad_f_old = Gradient(x).dot(p);
+  double line_search(const V &x, const V &p, VecFun<V, double> &f, GradFun<V> &Gradient) {
+    RefVecFun<V> f_ref = counted(f);
+    RefGradFun<V> grad_ref = counted(Gradient);
+
+    V x_new(x.size());
+    V g_new(x.size());
+    grad_ref(x, g_new);
+    double f_new;
+    return line_search(x, p, f_ref(x), g_new.dot(p), f_ref, grad_ref, x_new, f_new, g_new);
+  }
+
+  /**
+   * @brief Allocation-free line search on borrowed vectors.
+   *
+   * Same algorithm as the overload above, but works on caller-owned
+   * buffers: the trial point is written into @p x_new and, on return,
+   * @p x_new, @p f_new and @p g_new hold the point, value and gradient at
+   * the returned step, so the caller does not need to evaluate them again.
+   *
+   * @param x Current point.
+   * @param p Search direction.
+   * @param f_old Value f(x).
+   * @param grad_f_old Directional derivative ∇f(x)ᵀp.
+   * @param f Objective function to minimize.
+   * @param Gradient Function writing the gradient of f in place.
+   * @param x_new Output: x + alpha p.
+   * @param f_new Output: f(x_new).
+   * @param g_new Output: ∇f(x_new).
+   *
+   * @return Step length alpha. If the Wolfe conditions are not met within
+   *         @ref max_line_iters, the last tested alpha is returned and
+   *         @ref _line_search_converged is cleared.
+   */
+  double line_search(const Eigen::Ref<const V> &x, const Eigen::Ref<const V> &p,
+                     double f_old, double grad_f_old,
+                     RefVecFun<V> &f, RefGradFun<V> &Gradient,
+                     Eigen::Ref<V> x_new, double &f_new, Eigen::Ref<V> g_new) {
+    if (_speculative_trials > 1)
+      return speculative_line_search(x, p, f_old, grad_f_old, f, Gradient, x_new, f_new, g_new);
 
     double inf = std::numeric_limits<double>::infinity();
     double alpha_min = 0.0;
@@ -147,8 +390,8 @@ protected:
     double alpha = 1.0;
 
     for (int i = 0; i < max_line_iters; ++i) {
-      V x_new = x + alpha * p;
-      double f_new = f(x_new);
+      x_new.noalias() = x + alpha * p;
+      f_new = f(x_new);
 
       // Armijo (sufficient decrease) condition
       if (f_new > f_old + c1 * alpha * grad_f_old) {
@@ -157,7 +400,8 @@ protected:
         continue;
       }
 
-      double grad_f_new_dot_p = Gradient(x_new).dot(p);
+      Gradient(x_new, g_new);
+      double grad_f_new_dot_p = g_new.dot(p);
 
       // Curvature condition
       if (grad_f_new_dot_p < c2 * grad_f_old) {
@@ -169,9 +413,196 @@ protected:
 
         continue;
       }
+      _line_search_converged = true;
       return alpha;
     }
     // Fallback: If no alpha is found, return the last one
+    _line_search_converged = false;
+    ++_line_search_failures;
+    x_new.noalias() = x + alpha * p;
+    f_new = f(x_new);
+    Gradient(x_new, g_new);
     return alpha;
   }
+
+private:
+  /// Bracket and current step of the sequential line search.
+  struct LineSearchState {
+    double alpha_min;
+    double alpha_max;
+    double alpha;
+  };
+
+  /// A trial step evaluated by the speculative line search.
+  struct Trial {
+    double alpha;
+    double f;
+    double slope;   ///< ∇f(x + alpha p)ᵀp, only if Armijo holds
+    bool has_grad;
+    size_t slot;    ///< Workspace holding x + alpha p and its gradient, or no_slot
+    double seconds; ///< Duration of the evaluations
+  };
+
+  static constexpr size_t no_slot = std::numeric_limits<size_t>::max();
+
+  /// Workspaces of the speculative line search, recycled across batches
+  /// and calls; about one per concurrent trial.
+  std::vector<V> _spec_x;
+  std::vector<V> _spec_g;
+  std::vector<char> _slot_used;
+  std::vector<Trial> _trials;
+
+  /// State after a failed Armijo test at s.alpha.
+  LineSearchState shrink(const LineSearchState &s) const {
+    return {s.alpha_min, s.alpha, rho * (s.alpha_min + s.alpha)};
+  }
+
+  /// State after a failed curvature test at s.alpha.
+  LineSearchState expand(const LineSearchState &s) const {
+    double inf = std::numeric_limits<double>::infinity();
+    return {s.alpha, s.alpha_max, s.alpha_max == inf ? 2 * s.alpha : rho * (s.alpha + s.alpha_max)};
+  }
+
+  const Trial *find_trial(double alpha) const {
+    for (const Trial &t : _trials)
+      if (t.alpha == alpha)
+        return &t;
+    return nullptr;
+  }
+
+  /**
+   * @brief Release the workspaces that can no longer hold the accepted step.
+   *
+   * A trial can only be accepted later if it satisfies both Wolfe
+   * conditions and lies strictly inside the bracket of @p s, since every
+   * step the search visits from s does. The others keep their values but
+   * give their workspace back.
+   */
+  void recycle_slots(const LineSearchState &s, double grad_f_old) {
+    _slot_used.assign(_spec_x.size(), 0);
+    for (Trial &t : _trials) {
+      if (t.slot == no_slot)
+        continue;
+      bool acceptable = t.has_grad && !(t.slope < c2 * grad_f_old) &&
+                        t.alpha > s.alpha_min && t.alpha < s.alpha_max;
+      if (acceptable)
+        _slot_used[t.slot] = 1;
+      else
+        t.slot = no_slot;
+    }
+  }
+
+  /// Take a free workspace, adding one only if all are in use.
+  size_t acquire_slot(Eigen::Index n) {
+    for (size_t k = 0; k < _slot_used.size(); ++k) {
+      if (!_slot_used[k]) {
+        _slot_used[k] = 1;
+        return k;
+      }
+    }
+    _spec_x.emplace_back(n);
+    _spec_g.emplace_back(n);
+    _slot_used.push_back(1);
+    return _spec_x.size() - 1;
+  }
+
+  /**
+   * @brief Speculative version of the line search.
+   *
+   * Replays the sequential algorithm; whenever it needs a step that has
+   * not been evaluated yet, the next @ref _speculative_trials untried steps
+   * of its decision tree (breadth first from the current state) are
+   * evaluated in parallel. Returns the same alpha as the sequential search.
+   */
+  double speculative_line_search(const Eigen::Ref<const V> &x, const Eigen::Ref<const V> &p,
+                                 double f_old, double grad_f_old,
+                                 RefVecFun<V> &f, RefGradFun<V> &Gradient,
+                                 Eigen::Ref<V> x_new, double &f_new, Eigen::Ref<V> g_new) {
+    using clock = std::chrono::steady_clock;
+    const double inf = std::numeric_limits<double>::infinity();
+    const int trials = _speculative_trials;
+
+    _trials.clear();
+    double batch_seconds = 0.0;
+    double sequential_seconds = 0.0;
+
+    LineSearchState s{0.0, inf, 1.0};
+
+    for (int i = 0; i < max_line_iters; ++i) {
+      const Trial *t = find_trial(s.alpha);
+
+      if (!t) {
+        if (!_spec_x.empty() && _spec_x.front().size() != x.size()) {
+          _spec_x.clear();
+          _spec_g.clear();
+        }
+        recycle_slots(s, grad_f_old);
+
+        // Collect the next untried steps of the decision tree
+        const size_t first = _trials.size();
+        std::deque<LineSearchState> queue{s};
+        for (int visited = 0; !queue.empty() && visited < 8 * trials &&
+                              static_cast<int>(_trials.size() - first) < trials;
+             ++visited) {
+          LineSearchState q = queue.front();
+          queue.pop_front();
+          if (!find_trial(q.alpha))
+            _trials.push_back({q.alpha, 0.0, 0.0, false, acquire_slot(x.size()), 0.0});
+          queue.push_back(shrink(q));
+          queue.push_back(expand(q));
+        }
+
+        const int batch = static_cast<int>(_trials.size() - first);
+        auto batch_start = clock::now();
+
+#pragma omp parallel for schedule(static, 1)
+        for (int j = 0; j < batch; ++j) {
+          auto start = clock::now();
+          Trial &trial = _trials[first + j];
+          V &xt = _spec_x[trial.slot];
+          xt.noalias() = x + trial.alpha * p;
+          trial.f = f(xt);
+          if (!(trial.f > f_old + c1 * trial.alpha * grad_f_old)) {
+            Gradient(xt, _spec_g[trial.slot]);
+            trial.slope = _spec_g[trial.slot].dot(p);
+            trial.has_grad = true;
+          }
+          trial.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        }
+
+        batch_seconds += std::chrono::duration<double>(clock::now() - batch_start).count();
+        t = find_trial(s.alpha);
+      }
+
+      sequential_seconds += t->seconds;
+
+      // Armijo (sufficient decrease) condition
+      if (!t->has_grad) {
+        s = shrink(s);
+        continue;
+      }
+
+      // Curvature condition
+      if (t->slope < c2 * grad_f_old) {
+        s = expand(s);
+        continue;
+      }
+
+      x_new = _spec_x[t->slot];
+      g_new = _spec_g[t->slot];
+      f_new = t->f;
+      _line_search_converged = true;
+      _time_saved.push_back(sequential_seconds - batch_seconds);
+      return s.alpha;
+    }
+
+    // Fallback: If no alpha is found, return the last one
+    _line_search_converged = false;
+    ++_line_search_failures;
+    _time_saved.push_back(sequential_seconds - batch_seconds);
+    x_new.noalias() = x + s.alpha * p;
+    f_new = f(x_new);
+    Gradient(x_new, g_new);
+    return s.alpha;
+  }
 };
@@ -34,9 +34,16 @@ public:
   V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
     Eigen::LDLT<M> ldlt;
 
-    for (_iters = 0; _iters < _max_iters && Gradient(x).norm() > _tol; ++_iters) {
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
+
+    V g(x.size()), x_new(x.size()), g_new(x.size());
+    double fx = f_counted(x);
+    grad_counted(x, g);
+
+    for (_iters = 0; this->keep_going(g.norm()); ++_iters) {
       M H = _hessFun(x);
-      V g = Gradient(x);
 
       check(H.rows() == H.cols(), "Hessian must be square");
       check(H.rows() == g.size(), "Hessian/gradient size mismatch");
@@ -50,9 +57,14 @@ public:
       if (p.dot(g) >= 0.0)
         p = -g;
 
-      double alpha = this->line_search(x, p, f, Gradient);
+      double f_new;
+      double alpha = this->line_search(x, p, fx, g.dot(p), f_counted, grad_counted, x_new, f_new, g_new);
+
+      this->check_step(fx, f_new, alpha * p.norm(), x.norm());
 
-      x = x + alpha * p;
+      x.swap(x_new);
+      g.swap(g_new);
+      fx = f_new;
     }
 
     return x;
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "common.hpp"
+#include "minimizer_base.hpp"
+#include <algorithm>
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+
+/**
+ * @brief Formula for the conjugacy parameter β of NonlinearCG.
+ *
+ * Below, y = ∇f_{k+1} − ∇f_k and d is the previous direction.
+ */
+enum class CGUpdate {
+  /// β = ‖∇f_{k+1}‖² / ‖∇f_k‖²; relies on restarts to avoid jamming.
+  FletcherReeves,
+  /// β = max(0, ∇f_{k+1}ᵀy / ‖∇f_k‖²); restarts itself when progress stalls.
+  PolakRibierePlus,
+  /// CG_DESCENT: β = (y − 2d ‖y‖² / dᵀy)ᵀ∇f_{k+1} / dᵀy, truncated from
+  /// below; gives sufficient descent independently of the line search.
+  HagerZhang,
+  /// β = ‖∇f_{k+1}‖² / dᵀy; descent under the (weak) Wolfe conditions.
+  DaiYuan
+};
+
+/**
+ * @brief Nonlinear conjugate gradient minimizer.
+ *
+ * Generates the directions d_{k+1} = −∇f_{k+1} + β_k d_k, with β_k given by
+ * a CGUpdate formula, and uses the Wolfe line search of MinimizerBase with
+ * a tighter curvature parameter (c2 = 0.1) than the quasi-Newton solvers.
+ * The direction is reset to steepest descent
+ *  - every setRestartInterval() iterations (n by default);
+ *  - when consecutive gradients are far from orthogonal, i.e.
+ *    |∇f_{k+1}ᵀ∇f_k| >= ν ‖∇f_{k+1}‖² (Powell's test, see
+ *    setRestartThreshold());
+ *  - when the new direction is not a descent direction, or the line search
+ *    failed.
+ *
+ * Since CG directions are not scaled like Newton steps, each line search
+ * starts from a step predicted by interpolation and refined by a quadratic
+ * fit along the new direction (see initial_step()).
+ *
+ * Only four vectors of size n are kept (gradient, new gradient, direction
+ * and trial point), against 2m + 4 for LBFGS, which makes this the solver
+ * of choice when even the L-BFGS history does not fit in memory. The
+ * vectors are members, so repeated solves of the same size do not
+ * allocate.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd); only used for the base class.
+ */
+template <typename V, typename M>
+class NonlinearCG : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_iters;
+  using Base::alpha_wolfe;
+  using Base::c2;
+
+public:
+  /**
+   * @param update Formula for β.
+   */
+  explicit NonlinearCG(CGUpdate update = CGUpdate::HagerZhang) : _update(update) { c2 = 0.1; }
+
+  /// Get the formula used for β.
+  CGUpdate update() const noexcept { return _update; }
+
+  /**
+   * @brief Set the number of iterations between periodic restarts.
+   *
+   * @param iters Iterations between restarts (0 means n).
+   */
+  void setRestartInterval(unsigned int iters) noexcept { _restart_interval = iters; }
+
+  /**
+   * @brief Set the threshold ν of Powell's restart test.
+   *
+   * @param nu Restart when |∇f_{k+1}ᵀ∇f_k| >= ν ‖∇f_{k+1}‖² (default 0.2);
+   *        infinity disables the test.
+   */
+  void setRestartThreshold(double nu) noexcept { _nu = nu; }
+
+  /// Number of restarts to steepest descent in the last solve().
+  unsigned int restarts() const noexcept { return _restarts; }
+
+  /**
+   * @brief Run nonlinear CG from the initial guess @p x.
+   *
+   * @param x Initial guess (passed by value).
+   * @param f Objective function.
+   * @param Gradient Gradient function.
+   * @return Approximate minimizer.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    RefVecFun<V> f_ref = [&f](const Eigen::Ref<const V> &v) { return f(v); };
+    RefGradFun<V> grad_ref = [&Gradient](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) { g = Gradient(v); };
+
+    solve(x, f_ref, grad_ref);
+    return x;
+  }
+
+  /**
+   * @brief Nonlinear CG in place on a caller-owned parameter buffer.
+   *
+   * @param x Initial guess on input, final estimate on output.
+   * @param f Objective function on borrowed vectors.
+   * @param Gradient Function writing ∇f(x) into its second argument.
+   */
+  void solve(Eigen::Ref<V> x, RefVecFun<V> &f, RefGradFun<V> &Gradient) {
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
+
+    const Eigen::Index n = x.size();
+    _g.resize(n);
+    _g_new.resize(n);
+    _p.resize(n);
+    _x_new.resize(n);
+    _restarts = 0;
+
+    const unsigned int interval = _restart_interval > 0 ? _restart_interval : static_cast<unsigned int>(n);
+
+    double fx = f_counted(x);
+    grad_counted(x, _g);
+    double gg = _g.squaredNorm();
+
+    // The line search always tries alpha = 1, so _p is scaled by the
+    // initial step t during the search
+    double tau = first_step(x, fx, gg);
+    _p = -_g;
+    double slope_d = -gg;
+    unsigned int since_restart = 0;
+
+    for (_iters = 0; this->keep_going(std::sqrt(gg)); ++_iters) {
+      double t = _iters == 0 ? tau : initial_step(x, fx, slope_d, tau, f_counted);
+      _p *= t;
+      double slope = t * slope_d;
+      double f_new;
+      alpha_wolfe = this->line_search(x, _p, fx, slope, f_counted, grad_counted, _x_new, f_new, _g_new);
+
+      this->check_step(fx, f_new, alpha_wolfe * _p.norm(), x.norm());
+
+      // Inner products of the unscaled direction d = p / t with y, ∇f_{k+1}
+      double gg_new = _g_new.squaredNorm();
+      double g_new_g = _g_new.dot(_g);
+      double dg_new = _g_new.dot(_p) / t;
+      double dy = dg_new - slope / t;
+
+      ++since_restart;
+      bool restart = !this->_line_search_converged || since_restart >= interval ||
+                     std::abs(g_new_g) >= _nu * gg_new;
+
+      double beta = 0.0;
+      if (!restart) {
+        switch (_update) {
+        case CGUpdate::FletcherReeves:
+          beta = gg_new / gg;
+          break;
+        case CGUpdate::PolakRibierePlus:
+          beta = std::max(0.0, (gg_new - g_new_g) / gg);
+          break;
+        case CGUpdate::HagerZhang: {
+          double yy = (_g_new - _g).squaredNorm();
+          double eta = -1.0 / (_p.norm() / t * std::min(0.01, std::sqrt(gg)));
+          beta = std::max((gg_new - g_new_g - 2.0 * yy * dg_new / dy) / dy, eta);
+          break;
+        }
+        case CGUpdate::DaiYuan:
+          beta = gg_new / dy;
+          break;
+        }
+        restart = !std::isfinite(beta);
+      }
+
+      double f_old = fx;
+      x = _x_new;
+      _g.swap(_g_new);
+      fx = f_new;
+      gg = gg_new;
+
+      // d_{k+1} = −∇f_{k+1} + β d_k, in place
+      if (restart) {
+        _p = -_g;
+      } else {
+        _p *= beta / t;
+        _p -= _g;
+      }
+      slope_d = _g.dot(_p);
+      if (!restart && !(slope_d < 0.0)) {
+        restart = true;
+        _p = -_g;
+        slope_d = -gg;
+      }
+      if (restart) {
+        ++_restarts;
+        since_restart = 0;
+      }
+
+      // Guess for the initial step from the quadratic interpolating f_k,
+      // f_{k+1} and the new slope; once f stagnates at roundoff level, from
+      // the step with the same first-order decrease instead. After a failed
+      // line search, start over from the first guess.
+      if (!this->_line_search_converged) {
+        tau = first_step(x, fx, gg);
+      } else {
+        tau = 2.02 * (f_new - f_old) / slope_d;
+        if (!(std::isfinite(tau) && tau > 0.0))
+          tau = alpha_wolfe * slope / slope_d;
+      }
+    }
+  }
+
+private:
+  /**
+   * @brief Guess for the first step along −∇f, from Hager and Zhang:
+   * ψ0 ‖x‖∞ / ‖∇f‖∞, or ψ0 |f| / ‖∇f‖² at x = 0, with ψ0 = 0.01.
+   */
+  double first_step(const Eigen::Ref<const V> &x, double fx, double gg) const {
+    double x_max = x.template lpNorm<Eigen::Infinity>();
+    if (gg > 0.0 && x_max > 0.0)
+      return 0.01 * x_max / _g.template lpNorm<Eigen::Infinity>();
+    if (gg > 0.0 && fx != 0.0)
+      return 0.01 * std::abs(fx) / gg;
+    return 1.0;
+  }
+
+  /**
+   * @brief Initial step along the unscaled direction held in _p.
+   *
+   * Refines the guess @p tau with the minimizer of the quadratic through
+   * f(x), the slope ∇f(x)ᵀd and f(x + tau d), at the cost of one function
+   * evaluation (the QuadStep of CG_DESCENT). The line search only brackets
+   * by bisection, so a good first trial is what keeps CG directions close
+   * to conjugate. Keeps @p tau if the quadratic is not convex.
+   */
+  double initial_step(const Eigen::Ref<const V> &x, double fx, double slope, double tau, RefVecFun<V> &f) {
+    if (!(std::isfinite(tau) && tau > 0.0))
+      tau = 1.0;
+    _x_new.noalias() = x + tau * _p;
+    double q = f(_x_new) - fx - slope * tau;
+    double t = -slope * tau * tau / (2.0 * q);
+    return (q > 0.0 && std::isfinite(t)) ? t : tau;
+  }
+
+  CGUpdate _update;
+  unsigned int _restart_interval = 0;
+  double _nu = 0.2;
+  unsigned int _restarts = 0;
+
+  V _g;     ///< Current gradient.
+  V _g_new; ///< Gradient at the trial point.
+  V _p;     ///< Search direction (scaled by the initial step during the line search).
+  V _x_new; ///< Trial point.
+};
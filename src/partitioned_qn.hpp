@@ -0,0 +1,380 @@
+#pragma once
+
+#include "common.hpp"
+#include "minimizer_base.hpp"
+#include <algorithm>
+#include <eigen3/Eigen/Eigen>
+#include <eigen3/Eigen/Sparse>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Element of a partially separable objective f(x) = Σ_e f_e(x_e).
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ */
+template <typename V>
+struct ElementFunction {
+  /// Global indices of the variables x_e the element depends on.
+  std::vector<Eigen::Index> indices;
+
+  /// Gradient of f_e with respect to its local variables x_e.
+  GradFun<V> gradient;
+
+  /// Value of f_e on its local variables x_e. Optional: when every element
+  /// sets it, f is assembled from the elements too.
+  VecFun<V, double> function;
+};
+
+/**
+ * @brief Quasi-Newton update applied to each element Hessian.
+ */
+enum class ElementUpdate {
+  /// BFGS, skipping pairs with yᵀs <= 0: every element stays positive definite.
+  BFGS,
+  /// SR1: captures negative curvature, the assembled matrix may be
+  /// indefinite. Only worth it when elements are nonconvex at the solution.
+  SR1
+};
+
+/**
+ * @brief Partitioned quasi-Newton minimizer for partially separable problems.
+ *
+ * For objectives f(x) = Σ_e f_e(x_e) whose elements depend on a few
+ * variables each, keeps a small dense quasi-Newton approximation B_e per
+ * element and assembles them into the sparse matrix
+ *      B = Σ_e U_eᵀ B_e U_e,
+ * where U_e selects the variables of element e. The search direction solves
+ * B p = -∇f(x) with a sparse solver, followed by the usual line search.
+ * Memory and work scale with the number of nonzeros instead of n², and the
+ * element updates, which only need element gradients, run in parallel.
+ *
+ * ∇f is assembled from the element gradients, which are kept for the
+ * updates, so each iterate costs one pass over the elements; f is assembled
+ * as well when the elements provide their values.
+ *
+ * Prefer ElementUpdate::BFGS when the elements are convex near the
+ * solution, even if they are nonconvex elsewhere. The line search needs a
+ * descent direction, so an indefinite SR1 matrix gets a diagonal shift that
+ * discards part of the curvature SR1 captured: on the chained Rosenbrock
+ * function, whose 2×2 element Hessians are positive definite but badly
+ * conditioned at the minimum, SR1 makes almost every matrix indefinite and
+ * needs about 2.5 times the iterations of BFGS.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd); only used for the base class.
+ * @tparam Solver Sparse solver (e.g. Eigen::SimplicialLDLT or
+ *         Eigen::ConjugateGradient with Eigen::Lower | Eigen::Upper).
+ *         Iterative solvers like ConjugateGradient need a positive definite
+ *         matrix, i.e. ElementUpdate::BFGS.
+ */
+template <typename V, typename M,
+          typename Solver = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>>
+class PartitionedQuasiNewton : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_iters;
+  using Base::_max_iters;
+  using Base::_tol;
+
+  using SpMat = Eigen::SparseMatrix<double>;
+
+public:
+  /**
+   * @param update Quasi-Newton update used for the element matrices.
+   */
+  explicit PartitionedQuasiNewton(ElementUpdate update = ElementUpdate::BFGS)
+      : _update(update) {}
+
+  /**
+   * @brief Set the element decomposition of the objective.
+   *
+   * Must be called before solve(); the sparsity pattern of B is built here
+   * and reused by every subsequent solve.
+   *
+   * @param n Number of variables.
+   * @param elements Elements of the objective; together they must cover
+   *        every variable.
+   */
+  void setElements(Eigen::Index n, std::vector<ElementFunction<V>> elements) {
+    _elements = std::move(elements);
+    build_pattern(n);
+  }
+
+  /// Get the sparse solver (e.g. to set its tolerance).
+  Solver &solver() noexcept { return _solver; }
+
+  /**
+   * @brief Run the partitioned quasi-Newton method.
+   *
+   * @p Gradient is never called: ∇f is always assembled from the element
+   * gradients given to setElements(), which must describe the same
+   * objective as @p f.
+   *
+   * @param x Initial guess (passed by value).
+   * @param f Objective function, Σ_e f_e; not called if every element
+   *        provides its value.
+   * @param Gradient Ignored.
+   * @return Approximate minimizer.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> & /*Gradient*/) override {
+    check((_B.rows() == x.size()), "setElements must be called with the problem size");
+
+    this->start_solve();
+    const bool element_values = std::all_of(_elements.begin(), _elements.end(),
+                                            [](const ElementFunction<V> &el) { return bool(el.function); });
+    RefVecFun<V> f_elements = [this](const Eigen::Ref<const V> &v) { return element_sum(v); };
+    RefGradFun<V> grad_elements = [this](const Eigen::Ref<const V> &v, Eigen::Ref<V> g) { gradient(v, g); };
+    RefVecFun<V> f_counted = element_values ? this->counted(f_elements) : this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(grad_elements);
+
+    const size_t n_el = _elements.size();
+    for (size_t e = 0; e < n_el; ++e) {
+      const Eigen::Index k = static_cast<Eigen::Index>(_elements[e].indices.size());
+      _Be[e].setIdentity(k, k);
+      _scaled[e] = false;
+    }
+
+    V g(x.size()), x_next(x.size()), g_next(x.size());
+    double fx = f_counted(x);
+    grad_counted(x, g);
+    if (!cached(x))
+      element_gradients(x, _ge_next);
+    std::swap(_ge, _ge_next);
+
+    for (_iters = 0; this->keep_going(g.norm()); ++_iters) {
+      assemble();
+      V p = direction(g);
+
+      double f_next;
+      double alpha = this->line_search(x, p, fx, g.dot(p), f_counted, grad_counted,
+                                       x_next, f_next, g_next);
+
+      // The element gradients of the last gradient evaluation are those of
+      // x_next, except after a speculative line search
+      if (!cached(x_next)) {
+        this->count_evaluation();
+        element_gradients(x_next, _ge_next);
+      }
+      V s = alpha * p;
+
+      // Element updates are independent of each other
+#pragma omp parallel for schedule(dynamic, 64)
+      for (size_t e = 0; e < n_el; ++e)
+        update_element(e, s);
+
+      this->check_step(fx, f_next, s.norm(), x.norm());
+
+      x.swap(x_next);
+      g.swap(g_next);
+      fx = f_next;
+      std::swap(_ge, _ge_next);
+    }
+
+    return x;
+  }
+
+private:
+  /// Build the sparsity pattern of B and the element → nonzero map.
+  void build_pattern(Eigen::Index n) {
+    std::vector<Eigen::Triplet<double>> triplets;
+    std::vector<bool> covered(n, false);
+    for (Eigen::Index i = 0; i < n; ++i)
+      triplets.emplace_back(i, i, 0.0);
+    for (const ElementFunction<V> &el : _elements) {
+      for (Eigen::Index a : el.indices) {
+        check((a >= 0 && a < n), "element index out of range");
+        covered[a] = true;
+        for (Eigen::Index b : el.indices)
+          triplets.emplace_back(a, b, 0.0);
+      }
+    }
+    check((std::all_of(covered.begin(), covered.end(), [](bool c) { return c; })),
+          "every variable must belong to at least one element");
+
+    _B.resize(n, n);
+    _B.setFromTriplets(triplets.begin(), triplets.end());
+    _B.makeCompressed();
+
+    // Position of every element entry (a, b) in the value array of B
+    _slots.assign(_elements.size(), {});
+    for (size_t e = 0; e < _elements.size(); ++e) {
+      const std::vector<Eigen::Index> &idx = _elements[e].indices;
+      for (Eigen::Index b : idx) {
+        const int *begin = _B.innerIndexPtr() + _B.outerIndexPtr()[b];
+        const int *end = _B.innerIndexPtr() + _B.outerIndexPtr()[b + 1];
+        for (Eigen::Index a : idx)
+          _slots[e].push_back(std::lower_bound(begin, end, a) - _B.innerIndexPtr());
+      }
+    }
+
+    _Be.resize(_elements.size());
+    _scaled.resize(_elements.size());
+    _ge.resize(_elements.size());
+    _ge_next.resize(_elements.size());
+    _x_ge_next.resize(0);
+    _pattern_analyzed = false;
+  }
+
+  /// Gather the local variables of element @p e from @p v.
+  V gather(size_t e, const Eigen::Ref<const V> &v) const {
+    const std::vector<Eigen::Index> &idx = _elements[e].indices;
+    V local(idx.size());
+    for (size_t a = 0; a < idx.size(); ++a)
+      local(a) = v(idx[a]);
+    return local;
+  }
+
+  /// Evaluate every element gradient at @p x, in parallel.
+  void element_gradients(const Eigen::Ref<const V> &x, std::vector<V> &ge) const {
+    const size_t n_el = _elements.size();
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t e = 0; e < n_el; ++e)
+      ge[e] = _elements[e].gradient(gather(e, x));
+  }
+
+  /// f(x) = Σ_e f_e(x_e); elements in parallel, summed in a fixed order.
+  double element_sum(const Eigen::Ref<const V> &x) const {
+    const size_t n_el = _elements.size();
+    std::vector<double> fe(n_el);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t e = 0; e < n_el; ++e)
+      fe[e] = _elements[e].function(gather(e, x));
+
+    double val = 0.0;
+    for (double v : fe)
+      val += v;
+    return val;
+  }
+
+  /**
+   * @brief ∇f(x) = Σ_e U_eᵀ ∇f_e(x_e).
+   *
+   * The element gradients are left in _ge_next for the update. Concurrent
+   * calls from the speculative line search use their own buffers instead.
+   */
+  void gradient(const Eigen::Ref<const V> &x, Eigen::Ref<V> g) {
+    if (this->_speculative_trials > 1) {
+      std::vector<V> ge(_elements.size());
+      element_gradients(x, ge);
+      scatter(ge, g);
+      return;
+    }
+    element_gradients(x, _ge_next);
+    _x_ge_next = x;
+    scatter(_ge_next, g);
+  }
+
+  /// Sum the element gradients @p ge into the global gradient @p g.
+  void scatter(const std::vector<V> &ge, Eigen::Ref<V> g) const {
+    g.setZero();
+    for (size_t e = 0; e < _elements.size(); ++e) {
+      const std::vector<Eigen::Index> &idx = _elements[e].indices;
+      for (size_t a = 0; a < idx.size(); ++a)
+        g(idx[a]) += ge[e](a);
+    }
+  }
+
+  /// Whether _ge_next holds the element gradients at @p x.
+  bool cached(const V &x) const {
+    return this->_speculative_trials <= 1 && _x_ge_next.size() == x.size() && _x_ge_next == x;
+  }
+
+  /// Sum the element matrices into the values of B (pattern is fixed).
+  void assemble() {
+    double *values = _B.valuePtr();
+    std::fill(values, values + _B.nonZeros(), 0.0);
+    for (size_t e = 0; e < _elements.size(); ++e) {
+      const Eigen::MatrixXd &Be = _Be[e];
+      const Eigen::Index k = Be.rows();
+      for (Eigen::Index b = 0; b < k; ++b)
+        for (Eigen::Index a = 0; a < k; ++a)
+          values[_slots[e][b * k + a]] += Be(a, b);
+    }
+  }
+
+  /**
+   * @brief Solve B p = -g; if the factorization fails or p is not a descent
+   * direction (indefinite SR1 matrix) the diagonal is shifted and the solve
+   * repeated.
+   */
+  V direction(const V &g) {
+    double shift = 0.0;
+    const double diag_max = _B.diagonal().cwiseAbs().maxCoeff();
+    const V diag = _B.diagonal();
+
+    for (int attempt = 0; attempt < 30; ++attempt) {
+      if (shift > 0.0)
+        _B.diagonal() = diag.array() + shift;
+
+      if (!_pattern_analyzed) {
+        _solver.analyzePattern(_B);
+        _pattern_analyzed = true;
+      }
+      _solver.factorize(_B);
+
+      if (_solver.info() == Eigen::Success) {
+        V p = _solver.solve(-g);
+        if (_solver.info() == Eigen::Success && p.dot(g) < 0.0)
+          return p;
+      }
+      shift = shift > 0.0 ? 4.0 * shift : 1.e-3 * std::max(diag_max, 1.0);
+    }
+    return -g;
+  }
+
+  /// Quasi-Newton update of element @p e given the global step @p s.
+  void update_element(size_t e, const V &s) {
+    V se = gather(e, s);
+    V ye = _ge_next[e] - _ge[e];
+    Eigen::MatrixXd &Be = _Be[e];
+
+    double ss = se.dot(se);
+    if (ss == 0.0)
+      return;
+
+    double ys = ye.dot(se);
+    bool curvature = ys > 1.e-8 * std::sqrt(ss) * ye.norm();
+
+    // First informative step: rescale the identity to the element curvature
+    if (!_scaled[e] && curvature) {
+      Be *= ye.dot(ye) / ys;
+      _scaled[e] = true;
+    }
+
+    V Bs = Be * se;
+
+    if (_update == ElementUpdate::BFGS) {
+      // Skipping pairs without positive curvature keeps B_e positive
+      // definite on nonconvex elements
+      double sBs = se.dot(Bs);
+      if (curvature && sBs > 0.0)
+        Be += (ye * ye.transpose()) / ys - (Bs * Bs.transpose()) / sBs;
+    } else {
+      V res = ye - Bs;
+      double denom = res.dot(se);
+      if (std::abs(denom) > 1.e-8 * std::sqrt(ss) * res.norm())
+        Be += (res * res.transpose()) / denom;
+    }
+  }
+
+  ElementUpdate _update;
+  std::vector<ElementFunction<V>> _elements;
+
+  /// Dense approximation of each element Hessian.
+  std::vector<Eigen::MatrixXd> _Be;
+  /// Whether B_e has been rescaled after its initial identity (char, not
+  /// bool, so that concurrent element updates do not share bytes).
+  std::vector<char> _scaled;
+  /// Element gradients at the current and next iterate.
+  std::vector<V> _ge, _ge_next;
+  /// Point of the last gradient evaluation, whose element gradients are in _ge_next.
+  V _x_ge_next;
+
+  /// Assembled sparse approximation, with a fixed pattern.
+  SpMat _B;
+  /// For each element, positions of its entries in _B.valuePtr() (column-major).
+  std::vector<std::vector<Eigen::Index>> _slots;
+
+  Solver _solver;
+  bool _pattern_analyzed = false;
+};
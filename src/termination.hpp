@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Reason why the last call to solve() returned.
+ */
+enum class SolverStatus {
+  /// solve() has not been called yet.
+  NotStarted,
+  /// The solve is in progress.
+  Running,
+  /// ||∇f|| fell below the tolerance.
+  GradientTolerance,
+  /// The relative decrease of f fell below TerminationCriteria::function_tolerance.
+  FunctionTolerance,
+  /// The step length fell below TerminationCriteria::step_tolerance.
+  StepTolerance,
+  /// Too many consecutive line searches failed to satisfy the Wolfe conditions.
+  LineSearchFailed,
+  /// The maximum number of iterations was reached.
+  MaxIterations,
+  /// The wall-clock budget was exhausted.
+  TimeLimit,
+  /// The budget on function and gradient evaluations was exhausted.
+  EvaluationLimit,
+  /// The cancellation token was set.
+  Cancelled
+};
+
+/**
+ * @brief Human-readable name of a SolverStatus.
+ */
+inline const char *toString(SolverStatus status) {
+  switch (status) {
+  case SolverStatus::NotStarted:
+    return "not started";
+  case SolverStatus::Running:
+    return "running";
+  case SolverStatus::GradientTolerance:
+    return "gradient tolerance reached";
+  case SolverStatus::FunctionTolerance:
+    return "function decrease below tolerance";
+  case SolverStatus::StepTolerance:
+    return "step below tolerance";
+  case SolverStatus::LineSearchFailed:
+    return "line search failed";
+  case SolverStatus::MaxIterations:
+    return "maximum iterations reached";
+  case SolverStatus::TimeLimit:
+    return "time limit reached";
+  case SolverStatus::EvaluationLimit:
+    return "evaluation limit reached";
+  case SolverStatus::Cancelled:
+    return "cancelled";
+  }
+  return "unknown";
+}
+
+/**
+ * @brief Optional stopping tests, in addition to the gradient tolerance and
+ * the maximum number of iterations.
+ *
+ * Every criterion is disabled by its default value. The budgets are checked
+ * once per iteration, so a solve overruns them by at most one iteration.
+ */
+struct TerminationCriteria {
+  /// Stop when |f_k − f_{k+1}| <= function_tolerance * max(|f_k|, 1).
+  double function_tolerance = 0.0;
+
+  /// Stop when ||x_{k+1} − x_k|| <= step_tolerance * max(||x_k||, 1).
+  double step_tolerance = 0.0;
+
+  /// Stop after this many consecutive failed line searches (0 disables).
+  unsigned int max_line_search_failures = 0;
+
+  /// Wall-clock budget of a single solve (zero disables).
+  std::chrono::duration<double> max_time{0.0};
+
+  /// Budget on the number of f plus ∇f evaluations (0 disables).
+  unsigned long max_evaluations = 0;
+
+  /// Cancellation token, polled once per iteration (nullptr disables).
+  const std::atomic<bool> *cancel = nullptr;
+};
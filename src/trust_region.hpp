@@ -0,0 +1,479 @@
+#pragma once
+
+#include "common.hpp"
+#include "minimizer_base.hpp"
+#include <algorithm>
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Positive root @p tau of ||z + tau d|| = delta.
+ *
+ * Used by the subproblem solvers to move from an interior point @p z to the
+ * trust-region boundary along direction @p d.
+ */
+template <typename V>
+double boundary_step(const V &z, const V &d, double delta) {
+  double dd = d.dot(d);
+  double zd = z.dot(d);
+  double zz = z.dot(z);
+  double disc = std::max(0.0, zd * zd - dd * (zz - delta * delta));
+  return (-zd + std::sqrt(disc)) / dd;
+}
+
+/**
+ * @brief Exact Hessian model for trust-region methods.
+ *
+ * The Hessian is evaluated through the function set with
+ * MinimizerBase::setHessian. Products B v never factorize the matrix; the
+ * LDLT is only computed when a subproblem solver asks for the full Newton
+ * step (e.g. dogleg).
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd).
+ */
+template <typename V, typename M>
+class NewtonModel {
+public:
+  /**
+   * @brief Initialize the model at the starting point.
+   *
+   * @param x Starting point.
+   * @param hessFun Function returning the Hessian at a point.
+   */
+  void reset(const V &x, const M &, const HessFun<V, M> &hessFun) {
+    check(hessFun, "NewtonModel requires a Hessian function (setHessian)");
+    _hessFun = hessFun;
+    _H = _hessFun(x);
+  }
+
+  /// Hessian-vector product H v.
+  V apply(const V &v) const { return _H * v; }
+
+  /**
+   * @brief Newton step p = -H^{-1} g, if H is positive definite.
+   *
+   * @return false if H is not positive definite (p is left untouched).
+   */
+  bool newton_step(const V &g, V &p) {
+    _ldlt.compute(_H);
+    if (_ldlt.info() != Eigen::Success || _ldlt.vectorD().minCoeff() <= 0.0)
+      return false;
+    p = _ldlt.solve(-g);
+    return true;
+  }
+
+  /// Re-evaluate the Hessian at the accepted point.
+  void update(const V &x_new, const V &, const V &) { _H = _hessFun(x_new); }
+
+private:
+  HessFun<V, M> _hessFun;
+  M _H;
+  Eigen::LDLT<M> _ldlt;
+};
+
+/**
+ * @brief Dense BFGS model for trust-region methods.
+ *
+ * Starts from the matrix set with MinimizerBase::setInitialHessian and
+ * applies the standard BFGS update on accepted steps. Pairs with
+ * yᵀs <= 0 are skipped so that B stays positive definite.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd).
+ */
+template <typename V, typename M>
+class BFGSModel {
+public:
+  /// Initialize the model with the initial Hessian guess @p B0.
+  void reset(const V &x, const M &B0, const HessFun<V, M> &) {
+    check((B0.rows() == x.size() && B0.cols() == x.size()),
+          "BFGSModel requires an initial Hessian of the problem size (setInitialHessian)");
+    _B = B0;
+  }
+
+  /// Product B v.
+  V apply(const V &v) const { return _B * v; }
+
+  /// Newton step p = -B^{-1} g through a Cholesky factorization of B.
+  bool newton_step(const V &g, V &p) {
+    _llt.compute(_B);
+    if (_llt.info() != Eigen::Success)
+      return false;
+    p = _llt.solve(-g);
+    return true;
+  }
+
+  /// BFGS update: B_{k+1} = B_k + (y yᵀ)/(yᵀ s) − (B s sᵀ B)/(sᵀ B s)
+  void update(const V &, const V &s, const V &y) {
+    double ys = y.dot(s);
+    if (ys <= std::numeric_limits<double>::epsilon() * s.norm() * y.norm())
+      return;
+
+    V Bs = _B * s;
+    _B = _B + (y * y.transpose()) / ys - (Bs * Bs.transpose()) / s.dot(Bs);
+  }
+
+private:
+  M _B;
+  Eigen::LLT<M> _llt;
+};
+
+/**
+ * @brief Limited-memory SR1 model for trust-region methods.
+ *
+ * Keeps the last @p m curvature pairs and applies B through the compact
+ * representation
+ *      B = γ I + Ψ (D + L + Lᵀ − γ SᵀS)^{-1} Ψᵀ,    Ψ = Y − γ S,
+ * where D and L are the diagonal and strictly lower part of SᵀY. The
+ * approximation may be indefinite, which is exactly what trust-region
+ * subproblem solvers such as SteihaugCG can exploit.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd).
+ */
+template <typename V, typename M>
+class LSR1Model {
+public:
+  /**
+   * @param m Number of stored curvature pairs.
+   */
+  explicit LSR1Model(size_t m = 15) : _m(static_cast<Eigen::Index>(m)) {}
+
+  /// Drop all stored pairs; B is reset to the identity.
+  void reset(const V &x, const M &, const HessFun<V, M> &) {
+    _S.resize(x.size(), _m);
+    _Y.resize(x.size(), _m);
+    _psi.resize(x.size(), _m);
+    _SY.resize(_m, _m);
+    _SS.resize(_m, _m);
+    _count = 0;
+    _head = 0;
+    _gamma = 1.0;
+  }
+
+  /// Product B v using the compact representation.
+  V apply(const V &v) const {
+    if (_count == 0)
+      return _gamma * v;
+    auto psi = _psi.leftCols(_count);
+    Eigen::VectorXd w = _lu.solve(psi.transpose() * v);
+    return _gamma * v + psi * w;
+  }
+
+  /// No cheap exact solve is available for the L-SR1 matrix.
+  bool newton_step(const V &, V &) { return false; }
+
+  /**
+   * @brief SR1 update with the usual safeguard.
+   *
+   * The pair is skipped when |sᵀ(y − B s)| < r ||s|| ||y − B s||, or when
+   * it would make the middle matrix singular. SᵀY and SᵀS are updated with
+   * the inner products of the new pair only, and the stored pairs are not
+   * touched until the new middle matrix is known to be invertible.
+   */
+  void update(const V &, const V &s, const V &y) {
+    const double r = 1e-8;
+    V res = y - apply(s);
+    double denom = s.dot(res);
+    if (std::abs(denom) < r * s.norm() * res.norm())
+      return;
+
+    // Column receiving the pair: the next free one, or the oldest pair
+    const bool full = _count == _m;
+    const Eigen::Index j = full ? _head : _count;
+    const Eigen::Index k = full ? _m : _count + 1;
+    const Eigen::Index head = full ? (_head + 1) % _m : 0;
+
+    double ys = y.dot(s);
+    double gamma = ys > 0.0 ? y.dot(y) / ys : _gamma;
+
+    // Candidate SᵀY and SᵀS; row and column j are replaced
+    _SY_next = _SY;
+    _SS_next = _SS;
+    _SY_next.col(j).head(k).noalias() = _S.leftCols(k).transpose() * y;
+    _SY_next.row(j).head(k).noalias() = s.transpose() * _Y.leftCols(k);
+    _SS_next.col(j).head(k).noalias() = _S.leftCols(k).transpose() * s;
+    _SS_next.row(j).head(k) = _SS_next.col(j).head(k).transpose();
+    _SY_next(j, j) = ys;
+    _SS_next(j, j) = s.dot(s);
+
+    // Middle matrix D + L + Lᵀ − γ SᵀS, in storage order: entry (a, b) is
+    // s_aᵀ y_b if pair a is not older than pair b, s_bᵀ y_a otherwise
+    Eigen::MatrixXd mid(k, k);
+    for (Eigen::Index b = 0; b < k; ++b) {
+      for (Eigen::Index a = 0; a < k; ++a) {
+        bool newer = (a - head + k) % k >= (b - head + k) % k;
+        mid(a, b) = (newer ? _SY_next(a, b) : _SY_next(b, a)) - gamma * _SS_next(a, b);
+      }
+    }
+    Eigen::FullPivLU<Eigen::MatrixXd> lu(mid);
+    if (!lu.isInvertible())
+      return;
+
+    // Commit the pair
+    _S.col(j) = s;
+    _Y.col(j) = y;
+    _SY.swap(_SY_next);
+    _SS.swap(_SS_next);
+    _lu = std::move(lu);
+    _count = k;
+    _head = head;
+    if (gamma != _gamma) {
+      _gamma = gamma;
+      _psi.leftCols(k) = _Y.leftCols(k) - _gamma * _S.leftCols(k);
+    } else {
+      _psi.col(j) = y - _gamma * s;
+    }
+  }
+
+private:
+  Eigen::Index _m;
+  /// Stored pairs as columns, filled in order and then overwritten
+  /// oldest first.
+  Eigen::MatrixXd _S;
+  Eigen::MatrixXd _Y;
+  /// Ψ = Y − γ S.
+  Eigen::MatrixXd _psi;
+  /// SᵀY and SᵀS of the stored columns, and their candidates during update().
+  Eigen::MatrixXd _SY, _SS;
+  Eigen::MatrixXd _SY_next, _SS_next;
+  /// Number of stored pairs, and column of the oldest one.
+  Eigen::Index _count = 0;
+  Eigen::Index _head = 0;
+  double _gamma = 1.0;
+  Eigen::FullPivLU<Eigen::MatrixXd> _lu;
+};
+
+/**
+ * @brief Steihaug–Toint truncated conjugate gradient subproblem solver.
+ *
+ * Approximately minimizes the quadratic model
+ *      m(p) = gᵀp + ½ pᵀ B p,   ||p|| <= delta
+ * using only products B v. CG stops on the boundary when it meets negative
+ * curvature or leaves the region, so indefinite models are handled without
+ * any factorization.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ */
+template <typename V>
+class SteihaugCG {
+public:
+  /// Set the maximum number of inner CG iterations (0 means n).
+  void setMaxIterations(int max_iters) noexcept { _max_iters = max_iters; }
+
+  /// Total number of inner CG iterations performed since construction.
+  long innerIterations() const noexcept { return _inner_iters; }
+
+  template <typename Model>
+  V solve(const V &g, Model &model, double delta) {
+    const double g_norm = g.norm();
+    // Forcing term giving superlinear convergence of the outer method
+    const double eps = std::min(0.5, std::sqrt(g_norm)) * g_norm;
+    const int max_iters = _max_iters > 0 ? _max_iters : static_cast<int>(g.size());
+
+    V z = V::Zero(g.size());
+    V r = g;
+    V d = -r;
+    double rr = r.dot(r);
+
+    for (int j = 0; j < max_iters; ++j, ++_inner_iters) {
+      V Bd = model.apply(d);
+      double dBd = d.dot(Bd);
+
+      // Negative curvature: follow d to the boundary
+      if (dBd <= 0.0)
+        return z + boundary_step(z, d, delta) * d;
+
+      double a = rr / dBd;
+      V z_next = z + a * d;
+
+      // Step leaves the trust region: stop on the boundary
+      if (z_next.norm() >= delta)
+        return z + boundary_step(z, d, delta) * d;
+
+      r += a * Bd;
+      double rr_next = r.dot(r);
+      if (std::sqrt(rr_next) < eps)
+        return z_next;
+
+      d = -r + (rr_next / rr) * d;
+      rr = rr_next;
+      z = z_next;
+    }
+    return z;
+  }
+
+private:
+  int _max_iters = 0;
+  long _inner_iters = 0;
+};
+
+/**
+ * @brief Dogleg subproblem solver.
+ *
+ * Combines the Cauchy point with the full step p_B = -B^{-1} g. Requires
+ * the model to provide newton_step(); if B is not positive definite the
+ * Cauchy point is returned instead. Best suited to the BFGSModel, which is
+ * positive definite by construction.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ */
+template <typename V>
+class Dogleg {
+public:
+  template <typename Model>
+  V solve(const V &g, Model &model, double delta) {
+    double g_norm = g.norm();
+    double gBg = g.dot(model.apply(g));
+
+    // Cauchy point (steepest descent minimizer of the model)
+    if (gBg <= 0.0)
+      return -(delta / g_norm) * g;
+    V p_u = -(g.dot(g) / gBg) * g;
+
+    V p_b;
+    if (!model.newton_step(g, p_b) || p_b.dot(g) >= 0.0) {
+      if (p_u.norm() >= delta)
+        return -(delta / g_norm) * g;
+      return p_u;
+    }
+
+    if (p_b.norm() <= delta)
+      return p_b;
+    if (p_u.norm() >= delta)
+      return -(delta / g_norm) * g;
+
+    V d = p_b - p_u;
+    return p_u + boundary_step(p_u, d, delta) * d;
+  }
+};
+
+/**
+ * @brief Trust-region minimizer for unconstrained optimization.
+ *
+ * At each iteration approximately solves the subproblem
+ *      min_p  gᵀp + ½ pᵀ B_k p    s.t. ||p|| <= Δ_k
+ * and accepts the step depending on the ratio between actual and predicted
+ * reduction, expanding or shrinking Δ_k accordingly. Unlike the line-search
+ * minimizers, negative curvature in B_k is used rather than discarded.
+ *
+ * @tparam V Vector type (e.g. Eigen::VectorXd).
+ * @tparam M Matrix type (e.g. Eigen::MatrixXd).
+ * @tparam Model Quadratic model (NewtonModel, BFGSModel or LSR1Model).
+ * @tparam Subproblem Subproblem solver (SteihaugCG or Dogleg).
+ */
+template <typename V, typename M,
+          typename Model = NewtonModel<V, M>,
+          typename Subproblem = SteihaugCG<V>>
+class TrustRegion : public MinimizerBase<V, M> {
+  using Base = MinimizerBase<V, M>;
+  using Base::_B;
+  using Base::_hessFun;
+  using Base::_iters;
+  using Base::_max_iters;
+  using Base::_tol;
+
+public:
+  TrustRegion() = default;
+
+  /**
+   * @param model Quadratic model, e.g. LSR1Model with a custom memory size.
+   * @param subproblem Subproblem solver.
+   */
+  explicit TrustRegion(Model model, Subproblem subproblem = Subproblem())
+      : _model(std::move(model)), _subproblem(std::move(subproblem)) {}
+
+  /// Set the initial trust-region radius Δ_0.
+  void setInitialRadius(double delta) noexcept { _delta0 = delta; }
+
+  /// Set the largest radius the region may grow to.
+  void setMaxRadius(double delta) noexcept { _delta_max = delta; }
+
+  /// Set the minimum actual/predicted reduction ratio to accept a step.
+  void setAcceptanceRatio(double eta) noexcept { _eta = eta; }
+
+  /// Access the subproblem solver (e.g. to read inner iteration counts).
+  Subproblem &subproblem() noexcept { return _subproblem; }
+
+  /**
+   * @brief Run the trust-region method.
+   *
+   * @param x Initial guess (passed by value).
+   * @param f Objective function.
+   * @param Gradient Gradient function.
+   * @return Approximate minimizer.
+   */
+  V solve(V x, VecFun<V, double> &f, GradFun<V> &Gradient) override {
+    this->start_solve();
+    RefVecFun<V> f_counted = this->counted(f);
+    RefGradFun<V> grad_counted = this->counted(Gradient);
+
+    double delta = _delta0;
+    double fx = f_counted(x);
+    V g(x.size());
+    grad_counted(x, g);
+
+    _model.reset(x, _B, _hessFun);
+
+    for (_iters = 0; this->keep_going(g.norm()); ++_iters) {
+      V p = _subproblem.solve(g, _model, delta);
+      double p_norm = p.norm();
+
+      // Region collapsed below machine precision: no further progress
+      if (p_norm <= std::numeric_limits<double>::epsilon() * std::max(1.0, x.norm())) {
+        this->_status = SolverStatus::StepTolerance;
+        break;
+      }
+
+      double predicted = -(g.dot(p) + 0.5 * p.dot(_model.apply(p)));
+      V x_trial = x + p;
+      double f_trial = f_counted(x_trial);
+      double ratio = (fx - f_trial) / predicted;
+      V g_trial;
+
+      // Near a minimizer the reduction drowns in the rounding error of f:
+      // judge the step by the gradient norm instead
+      double noise = 10.0 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(fx));
+      if (predicted > 0.0 && predicted < noise && std::abs(fx - f_trial) < noise) {
+        g_trial.resize(x.size());
+        grad_counted(x_trial, g_trial);
+        ratio = g_trial.norm() < g.norm() ? 1.0 : 0.0;
+      }
+
+      if (!(ratio >= 0.25))
+        delta = 0.25 * p_norm;
+      else if (ratio > 0.75 && p_norm >= 0.99 * delta)
+        delta = std::min(2.0 * delta, _delta_max);
+
+      if (predicted > 0.0 && ratio > _eta) {
+        if (g_trial.size() == 0) {
+          g_trial.resize(x.size());
+          grad_counted(x_trial, g_trial);
+        }
+        _model.update(x_trial, p, g_trial - g);
+        this->check_step(fx, f_trial, p_norm, x.norm());
+        x = x_trial;
+        fx = f_trial;
+        g = g_trial;
+      }
+    }
+
+    return x;
+  }
+
+private:
+  Model _model;
+  Subproblem _subproblem;
+
+  /// Initial trust-region radius.
+  double _delta0 = 1.0;
+
+  /// Upper bound on the trust-region radius.
+  double _delta_max = 1.e3;
+
+  /// Acceptance threshold on the reduction ratio.
+  double _eta = 1.e-4;
+};
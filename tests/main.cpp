@@ -1,17 +1,102 @@
+// Lets tests forbid Eigen heap allocations in selected sections
+#define EIGEN_RUNTIME_NO_MALLOC
+
 #include "test.hpp"
 #include <iostream>
 
 #include <eigen3/unsupported/Eigen/IterativeSolvers>
 
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 #include "../src/bfgs.hpp"
 #include "../src/common.hpp"
+#include "../src/finite_difference.hpp"
+#include "../src/finite_sum.hpp"
+#include "../src/hybrid.hpp"
 #include "../src/lbfgs.hpp"
+#include "../src/levenberg_marquardt.hpp"
 #include "../src/newton.hpp"
+#include "../src/nonlinear_cg.hpp"
+#include "../src/partitioned_qn.hpp"
+#include "../src/trust_region.hpp"
 
 using Vec = Eigen::VectorXd;
 using Mat = Eigen::MatrixXd;
+using SpMat = Eigen::SparseMatrix<double>;
+using SparseCG = Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper>;
 
 using minimizerPtr = std::shared_ptr<MinimizerBase<Vec, Mat>>;
+using sparseMinimizerPtr = std::shared_ptr<MinimizerBase<Vec, SpMat>>;
+
+// Solvers are value types; the evaluation counter must not make them move-only
+static_assert(std::is_copy_constructible_v<LBFGS<Vec, Mat>>, "LBFGS should be copyable");
+static_assert(std::is_copy_constructible_v<BFGS<Vec, Mat>>, "BFGS should be copyable");
+
+/**
+ * @brief Chained Rosenbrock function
+ *      f(x) = Σ_i 100 (x_{i+1} − x_i²)² + (1 − x_i)²,
+ * with its minimum 0 at [1, 1, ...]; shared by the solver-specific tests.
+ * The in-place versions serve the zero-copy entry points, the by-value ones
+ * the generic solve().
+ */
+namespace ChainedRosenbrock {
+
+double value(const Eigen::Ref<const Vec> &v) {
+  double val = 0.0;
+  for (Eigen::Index i = 0; i < v.size() - 1; ++i) {
+    double term1 = v(i + 1) - v(i) * v(i);
+    double term2 = 1.0 - v(i);
+    val += 100.0 * term1 * term1 + term2 * term2;
+  }
+  return val;
+}
+
+void gradient(const Eigen::Ref<const Vec> &v, Eigen::Ref<Vec> g) {
+  g.setZero();
+  for (Eigen::Index i = 0; i < v.size() - 1; ++i) {
+    double term1 = v(i + 1) - v(i) * v(i);
+    g(i) += -2.0 * (1.0 - v(i)) - 400.0 * v(i) * term1;
+    g(i + 1) += 200.0 * term1;
+  }
+}
+
+Mat hessian(Vec v) {
+  const Eigen::Index n = v.size();
+  Mat H = Mat::Zero(n, n);
+  for (Eigen::Index i = 0; i < n - 1; ++i) {
+    H(i, i) += 2.0 - 400.0 * (v(i + 1) - 3.0 * v(i) * v(i));
+    H(i, i + 1) -= 400.0 * v(i);
+    H(i + 1, i) -= 400.0 * v(i);
+    H(i + 1, i + 1) += 200.0;
+  }
+  return H;
+}
+
+/// Standard starting point [-1.2, 1, -1.2, 1, ...].
+Vec initial_guess(Eigen::Index n) {
+  Vec v(n);
+  for (Eigen::Index i = 0; i < n; ++i)
+    v(i) = (i % 2 == 0) ? -1.2 : 1.0;
+  return v;
+}
+
+} // namespace ChainedRosenbrock
+
+/// Adapt an in-place objective to the by-value signature of solve().
+VecFun<Vec, double> byValue(RefVecFun<Vec> f) {
+  return [f](Vec v) { return f(v); };
+}
+
+/// Adapt an in-place gradient to the by-value signature of solve().
+GradFun<Vec> byValue(RefGradFun<Vec> gradient) {
+  return [gradient](Vec v) {
+    Vec g(v.size());
+    gradient(v, g);
+    return g;
+  };
+}
 
 void test_rastrigin(minimizerPtr &solver) {
   
@@ -258,6 +343,573 @@ void test_ackley(minimizerPtr &solver) {
   check((grad(result).norm() <= 1.e-9), "should converge on ackley function");
 }
 
+void test_rastrigin_finite_sum(minimizerPtr &solver) {
+
+  // Same objective as test_rastrigin, assembled term by term
+  const double A = 10.0;
+  FiniteSum<Vec>::TermKernel term = [A](const Vec &v, Eigen::Index i, Vec &g) {
+    g(i) += 2.0 * v(i) + 2.0 * M_PI * A * std::sin(2.0 * M_PI * v(i));
+    return A + v(i) * v(i) - A * std::cos(2.0 * M_PI * v(i));
+  };
+  auto problem = FiniteSum<Vec>::fromTerms(500, term);
+
+  VecFun<Vec, double> f = problem.function();
+  GradFun<Vec> grad = problem.gradient();
+
+  HessFun<Vec, Mat> hess = [A](const Vec &v) {
+    const int n = static_cast<int>(v.size());
+    Mat H = Mat::Zero(n, n);
+    for (int i = 0; i < n; ++i)
+      H(i, i) = 2.0 + 4.0 * M_PI * M_PI * A * std::cos(2.0 * M_PI * v(i));
+    return H;
+  };
+
+  int n = 500;
+
+  Vec v(n);
+  for (int i = 0; i < n; ++i)
+    v(i) = (i % 2 == 0) ? 4.0 : -4.0;
+
+  Vec g(n);
+  check((std::abs(problem.evaluate(v, g) - 16.0 * n) <= 1.e-8), "finite sum value should match the closed form");
+
+#ifdef _OPENMP
+  // Same sum, built and evaluated with a different number of threads
+  Vec w = Vec::LinSpaced(n, -1.0, 1.0);
+  double fw = problem.evaluate(w, g);
+  const int threads = omp_get_max_threads();
+  omp_set_num_threads(threads > 1 ? 1 : 4);
+  Vec g_other(n);
+  double fw_other = FiniteSum<Vec>::fromTerms(500, term).evaluate(w, g_other);
+  omp_set_num_threads(threads);
+  check((fw == fw_other && g == g_other), "finite sum should not depend on the number of threads");
+#endif
+
+  Mat m(n, n);
+  m.setIdentity();
+
+  solver->setMaxIterations(5000);
+  solver->setTolerance(1.e-9);
+  solver->setInitialHessian(m);
+  solver->setHessian(hess);
+
+  Vec result = solver->solve(v, f, grad);
+
+  check((grad(result).norm() <= 1.e-8), "should converge on finite sum rastrigin function");
+}
+
+void test_rosenbrock_finite_differences(minimizerPtr &solver) {
+
+  // Written once for real and complex arguments
+  auto rosenbrock = [](const auto &v) {
+    typename std::decay_t<decltype(v)>::Scalar val = 0.0;
+    for (int i = 0; i < v.size() - 1; ++i) {
+      auto term1 = v(i + 1) - v(i) * v(i);
+      auto term2 = 1.0 - v(i);
+      val += 100.0 * term1 * term1 + term2 * term2;
+    }
+    return val;
+  };
+
+  VecFun<Vec, double> f = [rosenbrock](Vec v) { return rosenbrock(v); };
+  ComplexVecFun f_complex = [rosenbrock](Eigen::VectorXcd v) { return rosenbrock(v); };
+
+  GradFun<Vec> grad = complexStepGradient<Vec>(f_complex);
+  GradFun<Vec> grad_central = finiteDifferenceGradient<Vec>(f);
+  GradFun<Vec> grad_forward = finiteDifferenceGradient<Vec>(f, FiniteDifferenceMode::Forward);
+  GradFun<Vec> grad_adaptive = finiteDifferenceGradient<Vec>(f, FiniteDifferenceMode::Adaptive);
+
+  HessFun<Vec, Mat> hess = [&grad](Vec v) {
+    const int n = v.size();
+    Mat H(n, n);
+    for (int i = 0; i < n; ++i) {
+      double h = 1.e-6 * std::max(std::abs(v(i)), 1.0);
+      Vec vp = v, vm = v;
+      vp(i) += h;
+      vm(i) -= h;
+      H.col(i) = (grad(vp) - grad(vm)) / (2.0 * h);
+    }
+    return Mat(0.5 * (H + H.transpose()));
+  };
+
+  int n = 4;
+
+  Vec v(n);
+  for (int i = 0; i < n; ++i)
+    v(i) = (i % 2 == 0) ? -1.2 : 1.0;
+
+  check((gradientCheck(f, grad, v).passed), "complex step gradient should pass the gradient check");
+  check(((grad_central(v) - grad(v)).norm() <= 1.e-6 * grad(v).norm()), "central differences should match the complex step");
+  check(((grad_forward(v) - grad(v)).norm() <= 1.e-4 * grad(v).norm()), "forward differences should match the complex step");
+  check(((grad_adaptive(v) - grad(v)).norm() <= 1.e-10 * grad(v).norm()), "adaptive differences should match the complex step");
+
+  Mat m(n, n);
+  m.setIdentity();
+
+  solver->setMaxIterations(4000);
+  solver->setTolerance(1.e-12);
+  solver->setInitialHessian(m);
+  solver->setHessian(hess);
+
+  Vec result = solver->solve(v, f, grad);
+
+  Vec expected_min(n);
+  expected_min.setOnes();
+  check(((result - expected_min).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+}
+
+/// Whether @p solver globalizes with a trust region instead of a line search.
+bool uses_trust_region(const minimizerPtr &solver) {
+  return std::dynamic_pointer_cast<TrustRegion<Vec, Mat>>(solver) ||
+         std::dynamic_pointer_cast<TrustRegion<Vec, Mat, BFGSModel<Vec, Mat>, Dogleg<Vec>>>(solver) ||
+         std::dynamic_pointer_cast<TrustRegion<Vec, Mat, LSR1Model<Vec, Mat>>>(solver);
+}
+
+void test_rosenbrock_termination(minimizerPtr &solver) {
+
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+  HessFun<Vec, Mat> hess = ChainedRosenbrock::hessian;
+
+  int n = 4;
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  Mat m(n, n);
+  m.setIdentity();
+
+  solver->setMaxIterations(4000);
+  solver->setTolerance(1.e-12);
+  solver->setInitialHessian(m);
+  solver->setHessian(hess);
+
+  // Evaluation budget
+  TerminationCriteria criteria;
+  criteria.max_evaluations = 20;
+  solver->setTermination(criteria);
+  solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::EvaluationLimit), "should stop on the evaluation budget");
+  check((solver->evaluations() >= 20), "evaluation budget should be used up");
+
+  // Stagnation of f
+  criteria = TerminationCriteria();
+  criteria.function_tolerance = 1.e-3;
+  solver->setTermination(criteria);
+  solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::FunctionTolerance), "should stop on the relative decrease of f");
+
+  // Any accepted step is below a huge step tolerance
+  criteria = TerminationCriteria();
+  criteria.step_tolerance = 1.e6;
+  solver->setTermination(criteria);
+  solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::StepTolerance), "should stop on the step length");
+  check((solver->iterations() <= 1), "should stop after the first accepted step");
+
+  // Wall-clock budget used up before the first iteration ends
+  criteria = TerminationCriteria();
+  criteria.max_time = std::chrono::nanoseconds(1);
+  solver->setTermination(criteria);
+  solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::TimeLimit), "should stop on the time budget");
+  check((solver->iterations() <= 1), "time budget should be checked every iteration");
+
+  // A gradient of the wrong sign makes every line search fail; trust-region
+  // methods have none
+  if (!uses_trust_region(solver)) {
+    GradFun<Vec> wrong_grad = [&grad](Vec x) { return Vec(-grad(x)); };
+    criteria = TerminationCriteria();
+    criteria.max_line_search_failures = 1;
+    solver->setTermination(criteria);
+    solver->solve(v, f, wrong_grad);
+    check((solver->status() == SolverStatus::LineSearchFailed), "should stop on line search failures");
+    check((solver->lineSearchFailures() == 1 && solver->iterations() <= 1), "should stop on the first failed line search");
+  }
+
+  // Cancellation before the first iteration
+  std::atomic<bool> cancel(true);
+  criteria = TerminationCriteria();
+  criteria.cancel = &cancel;
+  solver->setTermination(criteria);
+  Vec result = solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::Cancelled), "should stop when cancelled");
+  check((solver->iterations() == 0 && result == v), "cancelled solve should not move");
+
+  // Default policy: gradient tolerance
+  solver->setTermination(TerminationCriteria());
+  solver->solve(v, f, grad);
+  check((solver->status() == SolverStatus::GradientTolerance), "should stop on the gradient tolerance");
+}
+
+void test_rosenbrock_in_place(minimizerPtr &solver) {
+  auto lbfgs = std::dynamic_pointer_cast<LBFGS<Vec, Mat>>(solver);
+  check((lbfgs != nullptr), "in-place test requires an LBFGS implementation");
+
+  RefVecFun<Vec> f = ChainedRosenbrock::value;
+  RefGradFun<Vec> grad = ChainedRosenbrock::gradient;
+
+  // Parameters live in an externally owned buffer
+  const int n = 100;
+  std::vector<double> arena(n);
+  Eigen::Map<Vec> x(arena.data(), n);
+  x = ChainedRosenbrock::initial_guess(n);
+
+  LBFGSWorkspace<Vec> ws(n, 15);
+
+  lbfgs->setMaxIterations(4000);
+  lbfgs->setTolerance(1.e-10);
+
+  Eigen::internal::set_is_malloc_allowed(false);
+  lbfgs->solve(x, f, grad, ws);
+  Eigen::internal::set_is_malloc_allowed(true);
+
+  Vec g(n);
+  grad(x, g);
+  check((g.norm() <= 1.e-10), "should converge on rosenbrock function in place");
+  check(((x - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+}
+
+void test_rosenbrock_speculative(minimizerPtr &solver) {
+  auto speculative = std::dynamic_pointer_cast<LBFGS<Vec, Mat>>(solver);
+  check((speculative != nullptr), "speculative line search test requires an LBFGS implementation");
+
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+
+  int n = 100;
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  speculative->setMaxIterations(4000);
+  speculative->setTolerance(1.e-10);
+
+  // Same settings, one trial at a time
+  LBFGS<Vec, Mat> sequential = *speculative;
+  sequential.setSpeculativeTrials(1);
+
+  Vec expected = sequential.solve(v, f, grad);
+  Vec result = speculative->solve(v, f, grad);
+  check((grad(result).norm() <= 1.e-10), "should converge on chained rosenbrock function");
+  check((result == expected), "iterates should match the sequential line search");
+  check((speculative->iterations() == sequential.iterations()), "iteration count should match the sequential line search");
+  check((speculative->lineSearchTimeSaved().size() == static_cast<size_t>(speculative->iterations())),
+        "should record the time saved by each line search");
+
+  // Workspaces are recycled: a second solve gives the same result
+  result = speculative->solve(v, f, grad);
+  check((result == expected), "repeated solve should match the sequential line search");
+}
+
+void test_rosenbrock_forcing_term(minimizerPtr &solver) {
+  auto bfgs = std::dynamic_pointer_cast<BFGS<Vec, Mat, Eigen::GMRES<Mat>>>(solver);
+  check((bfgs != nullptr), "forcing term test requires a BFGS + GMRES implementation");
+
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+
+  int n = 10;
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  Mat m(n, n);
+  m.setIdentity();
+
+  bfgs->setMaxIterations(4000);
+  bfgs->setTolerance(1.e-10);
+  bfgs->setInitialHessian(m);
+
+  // Exact inner solves
+  bfgs->setForcingTerm(0.0);
+  Vec exact = bfgs->solve(v, f, grad);
+  long exact_inner = bfgs->innerIterations();
+  check((grad(exact).norm() <= 1.e-10), "should converge with exact inner solves");
+
+  // Default forcing sequence
+  bfgs->setForcingTerm(0.1);
+  Vec inexact = bfgs->solve(v, f, grad);
+  check((grad(inexact).norm() <= 1.e-10), "should converge with inexact inner solves");
+  check(((inexact - exact).norm() <= 1.e-8), "inexact solves should reach the same minimum");
+  check((bfgs->innerIterations() < exact_inner), "forcing sequence should save inner iterations");
+}
+
+void test_rosenbrock_sparse_bfgs(sparseMinimizerPtr &solver) {
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+
+  int n = 20;
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  SpMat m(n, n);
+  m.setIdentity();
+
+  solver->setMaxIterations(4000);
+  solver->setTolerance(1.e-8);
+  solver->setInitialHessian(m);
+
+  // B fills in on the first update; a stale preconditioner must not keep
+  // referencing the sparse B_0
+  Vec result = solver->solve(v, f, grad);
+  check((grad(result).norm() <= 1.e-8), "should converge with a sparse initial Hessian");
+  check(((result - Vec::Ones(n)).norm() <= 1.e-6), "solution should be close to the global minimum [1, 1, ...]");
+}
+
+void test_rosenbrock_nonlinear_cg(minimizerPtr &solver) {
+  auto cg = std::dynamic_pointer_cast<NonlinearCG<Vec, Mat>>(solver);
+  check((cg != nullptr), "restart test requires a NonlinearCG implementation");
+
+  RefVecFun<Vec> f = ChainedRosenbrock::value;
+  RefGradFun<Vec> grad = ChainedRosenbrock::gradient;
+
+  const int n = 100;
+  std::vector<double> arena(n);
+  Eigen::Map<Vec> x(arena.data(), n);
+  auto reset = [&x]() { x = ChainedRosenbrock::initial_guess(n); };
+
+  // Restarting at every iteration is steepest descent
+  cg->setMaxIterations(50);
+  cg->setRestartInterval(1);
+  reset();
+  cg->solve(x, f, grad);
+  check((cg->restarts() == static_cast<unsigned int>(cg->iterations())), "interval 1 should restart at every iteration");
+
+  // Default restart policy; a second solve of the same size reuses the
+  // vectors of the first one
+  cg->setMaxIterations(4000);
+  cg->setTolerance(1.e-10);
+  cg->setRestartInterval(0);
+  reset();
+  Eigen::internal::set_is_malloc_allowed(false);
+  cg->solve(x, f, grad);
+  Eigen::internal::set_is_malloc_allowed(true);
+
+  Vec g(n);
+  grad(x, g);
+  check((g.norm() <= 1.e-10), "should converge on rosenbrock function");
+  check(((x - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+  check((cg->restarts() > 0 && cg->restarts() < static_cast<unsigned int>(cg->iterations())),
+        "should restart, but not at every iteration");
+}
+
+void test_chained_rosenbrock_partitioned(minimizerPtr &solver) {
+  const int n = 200;
+
+  // Element i: 100 (x_{i+1} − x_i²)² + (1 − x_i)² on (x_i, x_{i+1})
+  std::atomic<long> element_calls(0);
+  std::vector<ElementFunction<Vec>> elements(n - 1);
+  for (int i = 0; i < n - 1; ++i) {
+    elements[i].indices = {i, i + 1};
+    elements[i].gradient = [&element_calls](Vec v) {
+      ++element_calls;
+      Vec g(2);
+      g(0) = -2.0 * (1.0 - v(0)) - 400.0 * v(0) * (v(1) - v(0) * v(0));
+      g(1) = 200.0 * (v(1) - v(0) * v(0));
+      return g;
+    };
+  }
+
+  auto set_elements = [&solver, &elements]() {
+    if (auto pqn = std::dynamic_pointer_cast<PartitionedQuasiNewton<Vec, Mat>>(solver)) {
+      pqn->setElements(n, elements);
+    } else if (auto pqn_cg = std::dynamic_pointer_cast<PartitionedQuasiNewton<Vec, Mat, SparseCG>>(solver)) {
+      pqn_cg->setElements(n, elements);
+      pqn_cg->solver().setTolerance(1.e-12);
+    } else {
+      check(false, "partitioned test requires a PartitionedQuasiNewton implementation");
+    }
+  };
+
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  solver->setMaxIterations(20000);
+  solver->setTolerance(1.e-10);
+
+  // f given as a whole, ∇f assembled from the elements
+  set_elements();
+  Vec result = solver->solve(v, f, grad);
+
+  check((grad(result).norm() <= 1.e-10), "should converge on chained rosenbrock function");
+  check(((result - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+
+  // f assembled from the elements as well; the objective is never called
+  for (ElementFunction<Vec> &el : elements)
+    el.function = [&element_calls](Vec v) {
+      ++element_calls;
+      return 100.0 * std::pow(v(1) - v(0) * v(0), 2) + std::pow(1.0 - v(0), 2);
+    };
+  set_elements();
+  VecFun<Vec, double> f_unused = [](Vec) {
+    check(false, "objective should be assembled from the elements");
+    return 0.0;
+  };
+  element_calls = 0;
+  result = solver->solve(v, f_unused, grad);
+
+  check((grad(result).norm() <= 1.e-10), "should converge with element values");
+  check(((result - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+  check((element_calls == (n - 1) * static_cast<long>(solver->evaluations())),
+        "every pass over the elements should be counted as one evaluation");
+
+  // Every update and solver should stay within the documented factor of
+  // partitioned BFGS with the direct solver
+  PartitionedQuasiNewton<Vec, Mat> reference(ElementUpdate::BFGS);
+  reference.setElements(n, elements);
+  reference.setMaxIterations(20000);
+  reference.setTolerance(1.e-10);
+  reference.solve(v, f_unused, grad);
+  check((solver->iterations() <= 3 * reference.iterations()),
+        "iterations should stay close to those of partitioned BFGS");
+}
+
+void test_chained_rosenbrock_hybrid(minimizerPtr &solver) {
+  auto hybrid = std::dynamic_pointer_cast<HybridNewton<Vec, Mat>>(solver);
+  check((hybrid != nullptr), "switching test requires a HybridNewton implementation");
+
+  VecFun<Vec, double> f = byValue(ChainedRosenbrock::value);
+  GradFun<Vec> grad = byValue(ChainedRosenbrock::gradient);
+  HessFun<Vec, Mat> hess = ChainedRosenbrock::hessian;
+
+  int n = 10;
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  hybrid->setMaxIterations(4000);
+  hybrid->setTolerance(1.e-10);
+  hybrid->setHessian(hess);
+
+  // Default policy: at this size the dense Newton cost estimated from the
+  // dimension is below two L-BFGS iterations, so it switches to Newton in
+  // the quadratic basin
+  hybrid->setPolicy(HybridPolicy());
+  Vec result = hybrid->solve(v, f, grad);
+  check((grad(result).norm() <= 1.e-10), "should converge on chained rosenbrock function");
+  check(((result - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+  check((hybrid->switches() >= 1 && hybrid->newtonIterations() > 0), "should switch to Newton near the optimum");
+
+  // Newton-CG steps
+  HybridPolicy policy;
+  policy.newton_cg = true;
+  hybrid->setPolicy(policy);
+  result = hybrid->solve(v, f, grad);
+  check((grad(result).norm() <= 1.e-10), "should converge with Newton-CG steps");
+  check((hybrid->newtonIterations() > 0), "should take Newton-CG steps near the optimum");
+
+  // Newton assumed too expensive: pure L-BFGS
+  policy = HybridPolicy();
+  policy.newton_cost_estimate = 1.e12;
+  hybrid->setPolicy(policy);
+  result = hybrid->solve(v, f, grad);
+  check((grad(result).norm() <= 1.e-10), "should converge with L-BFGS steps only");
+  check((hybrid->newtonIterations() == 0), "should not switch when Newton is predicted slower");
+
+  hybrid->setPolicy(HybridPolicy());
+}
+
+/**
+ * @brief Give a least-squares problem to a LevenbergMarquardt solver.
+ *
+ * Generic minimizers only use f and ∇f; dense and sparse
+ * LevenbergMarquardt instances get the residual and its Jacobian, LSQR
+ * ones the matrix-free products.
+ */
+void set_least_squares(minimizerPtr &solver, VecFun<Vec, Vec> residual, JacobianFun<Vec, Mat> jacobian) {
+  if (auto lm = std::dynamic_pointer_cast<LevenbergMarquardt<Vec, Mat>>(solver)) {
+    if (lm->linearSolver() == LeastSquaresSolve::LSQR)
+      lm->setResidual(
+          residual,
+          [jacobian](const Vec &x, const Vec &v) { return Vec(jacobian(x) * v); },
+          [jacobian](const Vec &x, const Vec &u) { return Vec(jacobian(x).transpose() * u); });
+    else
+      lm->setResidual(residual, jacobian);
+  } else if (auto lm_sparse = std::dynamic_pointer_cast<LevenbergMarquardt<Vec, Mat, SpMat>>(solver)) {
+    lm_sparse->setResidual(residual, [jacobian](Vec x) { return SpMat(jacobian(x).sparseView()); });
+  }
+}
+
+void test_exponential_fit(minimizerPtr &solver) {
+  // Data from y = 2.5 exp(-1.3 t) + 0.5 with a small deterministic perturbation
+  const int m = 200;
+  Vec t(m), y(m);
+  for (int i = 0; i < m; ++i) {
+    t(i) = 0.05 * i;
+    y(i) = 2.5 * std::exp(-1.3 * t(i)) + 0.5 + 0.01 * std::sin(7.0 * i);
+  }
+
+  VecFun<Vec, Vec> residual = [t, y](Vec x) {
+    return Vec((x(0) * (-x(1) * t.array()).exp() + x(2)).matrix() - y);
+  };
+
+  JacobianFun<Vec, Mat> jacobian = [t](Vec x) {
+    Mat Jx(t.size(), 3);
+    Jx.col(0) = (-x(1) * t.array()).exp().matrix();
+    Jx.col(1) = (-x(0) * t.array() * (-x(1) * t.array()).exp()).matrix();
+    Jx.col(2).setOnes();
+    return Jx;
+  };
+
+  VecFun<Vec, double> f = [residual](Vec x) { return 0.5 * residual(x).squaredNorm(); };
+  GradFun<Vec> grad = [residual, jacobian](Vec x) { return Vec(jacobian(x).transpose() * residual(x)); };
+
+  Vec v(3);
+  v << 1.0, 1.0, 0.0;
+
+  solver->setMaxIterations(4000);
+  solver->setTolerance(1.e-9);
+  solver->setInitialHessian(Mat::Identity(3, 3));
+  set_least_squares(solver, residual, jacobian);
+
+  Vec result = solver->solve(v, f, grad);
+
+  check((grad(result).norm() <= 1.e-9), "should converge on exponential fit");
+  Vec expected(3);
+  expected << 2.5, 1.3, 0.5;
+  check(((result - expected).norm() <= 1.e-2), "fit should recover the model parameters");
+}
+
+void test_chained_rosenbrock_least_squares(minimizerPtr &solver) {
+  // f = ½ Σ_i (10 (x_{i+1} − x_i²))² + (1 − x_i)², one pair of residuals per link
+  const int n = 100;
+
+  VecFun<Vec, Vec> residual = [](Vec x) {
+    const Eigen::Index links = x.size() - 1;
+    Vec r(2 * links);
+    for (Eigen::Index i = 0; i < links; ++i) {
+      r(2 * i) = 10.0 * (x(i + 1) - x(i) * x(i));
+      r(2 * i + 1) = 1.0 - x(i);
+    }
+    return r;
+  };
+
+  JacobianFun<Vec, Mat> jacobian = [](Vec x) {
+    const Eigen::Index links = x.size() - 1;
+    Mat Jx = Mat::Zero(2 * links, x.size());
+    for (Eigen::Index i = 0; i < links; ++i) {
+      Jx(2 * i, i) = -20.0 * x(i);
+      Jx(2 * i, i + 1) = 10.0;
+      Jx(2 * i + 1, i) = -1.0;
+    }
+    return Jx;
+  };
+
+  VecFun<Vec, double> f = [residual](Vec x) { return 0.5 * residual(x).squaredNorm(); };
+  GradFun<Vec> grad = [residual, jacobian](Vec x) { return Vec(jacobian(x).transpose() * residual(x)); };
+
+  Vec v = ChainedRosenbrock::initial_guess(n);
+
+  solver->setMaxIterations(20000);
+  solver->setTolerance(1.e-10);
+  solver->setInitialHessian(Mat::Identity(n, n));
+  set_least_squares(solver, residual, jacobian);
+
+  Vec result = solver->solve(v, f, grad);
+
+  check((grad(result).norm() <= 1.e-10), "should converge on chained rosenbrock least squares");
+  check(((result - Vec::Ones(n)).norm() <= 1.e-8), "solution should be close to the global minimum [1, 1, ...]");
+}
+
 int main() {
   minimizerPtr bfgs = std::make_shared<BFGS<Vec, Mat>>();
   minimizerPtr lbfgs = std::make_shared<LBFGS<Vec, Mat>>();
@@ -269,16 +921,96 @@ int main() {
   solver.setMaxIterations(10000);
   auto bfgs_gmres = std::make_shared<BFGS<Vec, Mat, GMRES_Solver>>((solver));
 
+  auto hybrid = std::make_shared<HybridNewton<Vec, Mat>>();
+
+  auto lbfgs_speculative = std::make_shared<LBFGS<Vec, Mat>>();
+  lbfgs_speculative->setSpeculativeTrials(4);
+
+  minimizerPtr cg_fr = std::make_shared<NonlinearCG<Vec, Mat>>(CGUpdate::FletcherReeves);
+  minimizerPtr cg_prp = std::make_shared<NonlinearCG<Vec, Mat>>(CGUpdate::PolakRibierePlus);
+  minimizerPtr cg_hz = std::make_shared<NonlinearCG<Vec, Mat>>(CGUpdate::HagerZhang);
+  minimizerPtr cg_dy = std::make_shared<NonlinearCG<Vec, Mat>>(CGUpdate::DaiYuan);
+
+  minimizerPtr tr_newton = std::make_shared<TrustRegion<Vec, Mat>>();
+  minimizerPtr tr_bfgs = std::make_shared<TrustRegion<Vec, Mat, BFGSModel<Vec, Mat>, Dogleg<Vec>>>();
+  minimizerPtr tr_lsr1 = std::make_shared<TrustRegion<Vec, Mat, LSR1Model<Vec, Mat>>>();
+
   auto suite = Tests::TestSuite<Vec, Mat>();
 
   suite.addImplementation(bfgs, "BFGS");
   suite.addImplementation(lbfgs, "LBFGS");
+  suite.addImplementation(lbfgs_speculative, "LBFGS (speculative line search)");
   suite.addImplementation(bfgs_gmres, "BFGS + GMRES");
   suite.addImplementation(newton, "Newton");
+  suite.addImplementation(hybrid, "Hybrid L-BFGS/Newton");
+  suite.addImplementation(cg_fr, "Nonlinear CG (Fletcher-Reeves)");
+  suite.addImplementation(cg_prp, "Nonlinear CG (Polak-Ribiere+)");
+  suite.addImplementation(cg_hz, "Nonlinear CG (Hager-Zhang)");
+  suite.addImplementation(cg_dy, "Nonlinear CG (Dai-Yuan)");
+  suite.addImplementation(tr_newton, "Trust Region Newton (Steihaug-CG)");
+  suite.addImplementation(tr_bfgs, "Trust Region BFGS (dogleg)");
+  suite.addImplementation(tr_lsr1, "Trust Region L-SR1 (Steihaug-CG)");
 
   suite.addTest("rosenbrock function", test_rosenbrock);
   suite.addTest("ackley function", test_ackley);
   suite.addTest("rastrigin function", test_rastrigin);
+  suite.addTest("rastrigin function (parallel finite sum)", test_rastrigin_finite_sum);
+  suite.addTest("rosenbrock function (finite differences)", test_rosenbrock_finite_differences);
+  suite.addTest("rosenbrock function (termination criteria)", test_rosenbrock_termination);
+
+  // Solver-specific entry points and options
+  suite.addTest("rosenbrock function (in-place, Eigen::Map, n = 100)", test_rosenbrock_in_place, {"LBFGS"});
+  suite.addTest("chained rosenbrock function (speculative line search, n = 100)", test_rosenbrock_speculative,
+                {"LBFGS (speculative line search)"});
+  suite.addTest("chained rosenbrock function (forcing sequence, n = 10)", test_rosenbrock_forcing_term,
+                {"BFGS + GMRES"});
+  suite.addTest("chained rosenbrock function (switching policy, n = 10)", test_chained_rosenbrock_hybrid,
+                {"Hybrid L-BFGS/Newton"});
+  suite.addTest("rosenbrock function (restarts, in-place, n = 100)", test_rosenbrock_nonlinear_cg,
+                {"Nonlinear CG (Fletcher-Reeves)", "Nonlinear CG (Polak-Ribiere+)", "Nonlinear CG (Hager-Zhang)",
+                 "Nonlinear CG (Dai-Yuan)"});
 
   suite.runTests();
+
+  // Sparse initial Hessian, with the default ConjugateGradient solver
+  auto sparse_bfgs = std::make_shared<BFGS<Vec, SpMat>>();
+  auto sparse_bfgs_refresh = std::make_shared<BFGS<Vec, SpMat>>();
+  sparse_bfgs_refresh->setPreconditionerRefresh(3);
+
+  auto sparse_suite = Tests::TestSuite<Vec, SpMat>();
+  sparse_suite.addImplementation(sparse_bfgs, "BFGS (sparse B)");
+  sparse_suite.addImplementation(sparse_bfgs_refresh, "BFGS (sparse B, preconditioner refresh every 3 iterations)");
+  sparse_suite.addTest("chained rosenbrock function (n = 20)", test_rosenbrock_sparse_bfgs);
+  sparse_suite.runTests();
+
+  // Nonlinear least squares
+  minimizerPtr lm_qr = std::make_shared<LevenbergMarquardt<Vec, Mat>>(LeastSquaresSolve::QR);
+  minimizerPtr lm_cholesky = std::make_shared<LevenbergMarquardt<Vec, Mat>>(LeastSquaresSolve::Cholesky);
+  minimizerPtr lm_lsqr = std::make_shared<LevenbergMarquardt<Vec, Mat>>(LeastSquaresSolve::LSQR);
+  minimizerPtr lm_sparse_qr = std::make_shared<LevenbergMarquardt<Vec, Mat, SpMat>>(LeastSquaresSolve::QR);
+  minimizerPtr lm_sparse_cholesky = std::make_shared<LevenbergMarquardt<Vec, Mat, SpMat>>(LeastSquaresSolve::Cholesky);
+
+  auto least_squares_suite = Tests::TestSuite<Vec, Mat>();
+  least_squares_suite.addImplementation(bfgs, "BFGS");
+  least_squares_suite.addImplementation(lbfgs, "LBFGS");
+  least_squares_suite.addImplementation(lm_qr, "Levenberg-Marquardt (QR)");
+  least_squares_suite.addImplementation(lm_cholesky, "Levenberg-Marquardt (Cholesky)");
+  least_squares_suite.addImplementation(lm_lsqr, "Levenberg-Marquardt (LSQR, matrix-free)");
+  least_squares_suite.addImplementation(lm_sparse_qr, "Levenberg-Marquardt (sparse QR)");
+  least_squares_suite.addImplementation(lm_sparse_cholesky, "Levenberg-Marquardt (sparse Cholesky)");
+  least_squares_suite.addTest("exponential fit (m = 200)", test_exponential_fit);
+  least_squares_suite.addTest("chained rosenbrock least squares (n = 100)", test_chained_rosenbrock_least_squares);
+  least_squares_suite.runTests();
+
+  // Partially separable problems
+  minimizerPtr pqn_bfgs = std::make_shared<PartitionedQuasiNewton<Vec, Mat>>(ElementUpdate::BFGS);
+  minimizerPtr pqn_sr1 = std::make_shared<PartitionedQuasiNewton<Vec, Mat>>(ElementUpdate::SR1);
+  minimizerPtr pqn_cg = std::make_shared<PartitionedQuasiNewton<Vec, Mat, SparseCG>>(ElementUpdate::BFGS);
+
+  auto structured_suite = Tests::TestSuite<Vec, Mat>();
+  structured_suite.addImplementation(pqn_bfgs, "Partitioned BFGS");
+  structured_suite.addImplementation(pqn_sr1, "Partitioned SR1");
+  structured_suite.addImplementation(pqn_cg, "Partitioned BFGS (ConjugateGradient)");
+  structured_suite.addTest("chained rosenbrock function (n = 200)", test_chained_rosenbrock_partitioned);
+  structured_suite.runTests();
 }
@@ -0,0 +1,271 @@
+// Tests and scaling benchmark of DistributedLBFGS.
+// Run with e.g. `mpirun -np 4 ./mpi_test_runner`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "../src/common.hpp"
+#include "../src/distributed_lbfgs.hpp"
+#include "../src/finite_sum.hpp"
+#include "../src/lbfgs.hpp"
+
+using Vec = Eigen::VectorXd;
+using Mat = Eigen::MatrixXd;
+
+/**
+ * @brief Extended Rosenbrock function on the pairs [pair_begin, pair_end).
+ *
+ * f(x) = Σ_i 100 (x_{2i+1} − x_{2i}²)² + (1 − x_{2i})²; the pairs are
+ * independent, so splitting them over the ranks needs no halo exchange.
+ * The local vector holds the variables of the local pairs only.
+ */
+struct ExtendedRosenbrock {
+  VecFun<Vec, double> f = [](Vec v) {
+    double val = 0.0;
+    for (Eigen::Index i = 0; i + 1 < v.size(); i += 2) {
+      double t1 = v(i + 1) - v(i) * v(i);
+      double t2 = 1.0 - v(i);
+      val += 100.0 * t1 * t1 + t2 * t2;
+    }
+    return val;
+  };
+
+  GradFun<Vec> grad = [](Vec v) {
+    Vec g(v.size());
+    for (Eigen::Index i = 0; i + 1 < v.size(); i += 2) {
+      double t1 = v(i + 1) - v(i) * v(i);
+      g(i) = -400.0 * v(i) * t1 - 2.0 * (1.0 - v(i));
+      g(i + 1) = 200.0 * t1;
+    }
+    return g;
+  };
+
+  static Vec initial_guess(Eigen::Index n) {
+    Vec v(n);
+    for (Eigen::Index i = 0; i < n; ++i)
+      v(i) = (i % 2 == 0) ? -1.2 : 1.0;
+    return v;
+  }
+};
+
+/**
+ * @brief L2-regularized logistic regression on synthetic data.
+ *
+ * f(w) = 1/N Σ_i log(1 + exp(−b_i a_iᵀw)) + λ/2 ‖w‖², with features
+ * generated from the term index and labels from a planted model, so every
+ * rank can build its own shard.
+ */
+struct LogisticRegression {
+  Eigen::Index terms;
+  Eigen::Index dim;
+  double lambda = 1.e-3;
+
+  static double feature(Eigen::Index i, Eigen::Index j) {
+    return std::sin(12.9898 * static_cast<double>(i) + 78.233 * static_cast<double>(j));
+  }
+
+  double label(Eigen::Index i) const {
+    double z = 0.0;
+    for (Eigen::Index j = 0; j < dim; ++j)
+      z += std::cos(static_cast<double>(j)) * feature(i, j);
+    return z >= 0.0 ? 1.0 : -1.0;
+  }
+
+  /// Finite sum over the terms [begin, end), without the regularization.
+  FiniteSum<Vec> shard(Eigen::Index begin, Eigen::Index end) const {
+    LogisticRegression problem = *this;
+    return FiniteSum<Vec>::fromTerms(end - begin, [problem, begin](const Vec &w, Eigen::Index k, Vec &g) {
+      Eigen::Index i = begin + k;
+      double scale = 1.0 / static_cast<double>(problem.terms);
+      double b = problem.label(i);
+      double z = 0.0;
+      for (Eigen::Index j = 0; j < problem.dim; ++j)
+        z += feature(i, j) * w(j);
+      double margin = b * z;
+      double sigma = 1.0 / (1.0 + std::exp(margin));
+      for (Eigen::Index j = 0; j < problem.dim; ++j)
+        g(j) -= scale * sigma * b * feature(i, j);
+      // log(1 + e^{−margin}) without overflow for large negative margins
+      return scale * (std::max(-margin, 0.0) + std::log1p(std::exp(-std::abs(margin))));
+    });
+  }
+
+  /// Objective and gradient of a shard, adding the regularization if @p regularize.
+  std::pair<VecFun<Vec, double>, GradFun<Vec>> functions(Eigen::Index begin, Eigen::Index end,
+                                                         bool regularize) const {
+    FiniteSum<Vec> sum = shard(begin, end);
+    VecFun<Vec, double> sum_f = sum.function();
+    GradFun<Vec> sum_g = sum.gradient();
+    double reg = regularize ? lambda : 0.0;
+    VecFun<Vec, double> f = [sum_f, reg](Vec w) { return sum_f(w) + 0.5 * reg * w.squaredNorm(); };
+    GradFun<Vec> g = [sum_g, reg](Vec w) { return Vec(sum_g(w) + reg * w); };
+    return {f, g};
+  }
+};
+
+/// Global 2-norm of a vector partitioned over @p comm.
+double global_norm(const Vec &v, MPI_Comm comm) {
+  double sq = v.squaredNorm();
+  MPI_Allreduce(MPI_IN_PLACE, &sq, 1, MPI_DOUBLE, MPI_SUM, comm);
+  return std::sqrt(sq);
+}
+
+void test_extended_rosenbrock_partitioned(MPI_Comm comm) {
+  const Eigen::Index pairs = 5000;
+  auto [begin, end] = localRange(pairs, comm);
+
+  ExtendedRosenbrock problem;
+  Vec x0 = ExtendedRosenbrock::initial_guess(2 * (end - begin));
+
+  DistributedLBFGS<Vec, Mat> solver(comm, DistributedLayout::PartitionedParameters);
+  solver.setMaxIterations(2000);
+  solver.setTolerance(1.e-8);
+  Vec result = solver.solve(x0, problem.f, problem.grad);
+
+  check((global_norm(problem.grad(result), comm) <= 1.e-8), "should converge on partitioned extended rosenbrock");
+  check((global_norm(result - Vec::Ones(result.size()), comm) <= 1.e-6),
+        "solution should be close to the global minimum [1, 1, ...]");
+
+  // Same iteration on a single process, as reference
+  LBFGS<Vec, Mat> serial;
+  serial.setMaxIterations(2000);
+  serial.setTolerance(1.e-8);
+  serial.solve(ExtendedRosenbrock::initial_guess(2 * pairs), problem.f, problem.grad);
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0) {
+    std::cout << "\t iterations:   " << solver.iterations() << " (serial LBFGS: " << serial.iterations() << ")"
+              << std::endl;
+    std::cout << "\t allreduces:   " << solver.allreduceCount() << std::endl;
+    std::cout << "\t status:       " << toString(solver.status()) << std::endl;
+  }
+}
+
+void test_logistic_regression_sharded(MPI_Comm comm) {
+  LogisticRegression problem{4000, 20};
+  auto [begin, end] = localRange(problem.terms, comm);
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  auto [f, grad] = problem.functions(begin, end, rank == 0);
+
+  DistributedLBFGS<Vec, Mat> solver(comm, DistributedLayout::ShardedData);
+  solver.setMaxIterations(1000);
+  solver.setTolerance(1.e-8);
+  Vec result = solver.solve(Vec::Zero(problem.dim), f, grad);
+
+  // Every rank must end with the same replica
+  Vec spread = result;
+  MPI_Allreduce(MPI_IN_PLACE, spread.data(), static_cast<int>(spread.size()), MPI_DOUBLE, MPI_MAX, comm);
+  check(((spread - result).norm() == 0.0), "replicas should stay identical across ranks");
+
+  auto [f_full, grad_full] = problem.functions(0, problem.terms, true);
+  check((grad_full(result).norm() <= 1.e-7), "should converge on sharded logistic regression");
+
+  LBFGS<Vec, Mat> serial;
+  serial.setMaxIterations(1000);
+  serial.setTolerance(1.e-8);
+  Vec reference = serial.solve(Vec::Zero(problem.dim), f_full, grad_full);
+  check(((result - reference).norm() <= 1.e-6), "should match the single-process solution");
+
+  if (rank == 0) {
+    std::cout << "\t iterations:   " << solver.iterations() << " (serial LBFGS: " << serial.iterations() << ")"
+              << std::endl;
+    std::cout << "\t allreduces:   " << solver.allreduceCount() << std::endl;
+    std::cout << "\t status:       " << toString(solver.status()) << std::endl;
+  }
+}
+
+/**
+ * @brief Strong scaling: solve the same problems on 1, 2, 4, ... ranks.
+ *
+ * Sub-communicators of growing size are split from MPI_COMM_WORLD, so a
+ * single `mpirun -np P` launch measures every power of two up to P. The
+ * reported time is the maximum over the ranks of the group.
+ */
+void scaling_benchmark() {
+  int world_rank, world_size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+  const Eigen::Index pairs = 1 << 19;
+  LogisticRegression regression{1 << 15, 64};
+
+  if (world_rank == 0)
+    std::cout << std::left << std::setw(36) << "  problem" << std::setw(8) << "ranks" << std::setw(12)
+              << "iterations" << std::setw(14) << "time (s)" << std::setw(14) << "comm (s)" << "speedup"
+              << std::endl;
+
+  for (const char *name : {"extended rosenbrock (n = 2^20)", "logistic regression (2^15 x 64)"}) {
+    double base_time = 0.0;
+    for (int ranks = 1; ranks <= world_size; ranks *= 2) {
+      MPI_Comm comm;
+      MPI_Comm_split(MPI_COMM_WORLD, world_rank < ranks ? 0 : MPI_UNDEFINED, world_rank, &comm);
+
+      if (comm != MPI_COMM_NULL) {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        bool rosenbrock = name[0] == 'e';
+
+        DistributedLBFGS<Vec, Mat> solver(comm, rosenbrock ? DistributedLayout::PartitionedParameters
+                                                           : DistributedLayout::ShardedData);
+        solver.setMaxIterations(rosenbrock ? 2000 : 200);
+        solver.setTolerance(1.e-6);
+
+        MPI_Barrier(comm);
+        auto before = std::chrono::steady_clock::now();
+        if (rosenbrock) {
+          ExtendedRosenbrock problem;
+          auto [begin, end] = localRange(pairs, comm);
+          solver.solve(ExtendedRosenbrock::initial_guess(2 * (end - begin)), problem.f, problem.grad);
+        } else {
+          auto [begin, end] = localRange(regression.terms, comm);
+          auto [f, grad] = regression.functions(begin, end, rank == 0);
+          solver.solve(Vec::Zero(regression.dim), f, grad);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+        double comm_seconds = solver.communicationSeconds();
+        MPI_Allreduce(MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX, comm);
+        MPI_Allreduce(MPI_IN_PLACE, &comm_seconds, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+        if (ranks == 1)
+          base_time = seconds;
+        if (rank == 0)
+          std::cout << "  " << std::setw(34) << name << std::setw(8) << ranks << std::setw(12)
+                    << solver.iterations() << std::setw(14) << seconds << std::setw(14) << comm_seconds
+                    << base_time / seconds << std::endl;
+        MPI_Comm_free(&comm);
+      }
+      MPI_Barrier(MPI_COMM_WORLD);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  MPI_Init(&argc, &argv);
+
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  if (rank == 0)
+    std::cout << "======================RUNNING TEST:extended rosenbrock (partitioned parameters, " << size
+              << " ranks)======================" << std::endl;
+  test_extended_rosenbrock_partitioned(MPI_COMM_WORLD);
+
+  if (rank == 0)
+    std::cout << "======================RUNNING TEST:logistic regression (sharded data, " << size
+              << " ranks)======================" << std::endl;
+  test_logistic_regression_sharded(MPI_COMM_WORLD);
+
+  if (rank == 0)
+    std::cout << "======================SCALING BENCHMARK======================" << std::endl;
+  scaling_benchmark();
+
+  MPI_Finalize();
+  return 0;
+}
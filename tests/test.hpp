@@ -1,4 +1,5 @@
 #include "../src/minimizer_base.hpp"
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
@@ -6,6 +7,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace Tests {
 
@@ -36,7 +38,7 @@ public:
    */
   TestSuite() {
     impls = std::map<std::string, minimizerPtr>();
-    tests = std::vector<std::pair<std::string, testFunction>>();
+    tests = std::vector<Test>();
   }
 
   /**
@@ -65,7 +67,21 @@ public:
    * @param fun  Test function to be executed on each implementation.
    */
   void addTest(std::string name, testFunction fun) {
-    tests.push_back(std::make_pair(name, fun));
+    tests.push_back({name, fun, {}});
+  }
+
+  /**
+   * @brief Register a test that only applies to some implementations.
+   *
+   * Used for solver-specific entry points and options; the test is skipped
+   * for every implementation not listed in @p only.
+   *
+   * @param name Descriptive name of the test (used in output).
+   * @param fun  Test function to be executed on the listed implementations.
+   * @param only Names of the implementations the test runs on.
+   */
+  void addTest(std::string name, testFunction fun, std::vector<std::string> only) {
+    tests.push_back({name, fun, std::move(only)});
   }
 
   /**
@@ -75,22 +91,26 @@ public:
    *  - prints a header with the test name,
    *  - runs the test on every registered implementation,
    *  - measures wall-clock time using std::chrono::steady_clock,
-   *  - prints elapsed time, number of iterations, and tolerance used
-   *    by the minimizer.
+   *  - prints elapsed time, number of iterations, tolerance, number of
+   *    function/gradient evaluations and stopping reason of the minimizer.
    */
   void runTests() {
-    for (std::pair<std::string, testFunction> &test : tests) {
+    for (Test &test : tests) {
       std::cout << "======================"
                    "RUNNING TEST:"
-                << test.first << "======================" << std::endl;
+                << test.name << "======================" << std::endl;
 
       for (auto &impl : impls) {
+        if (!test.only.empty() &&
+            std::find(test.only.begin(), test.only.end(), impl.first) == test.only.end())
+          continue;
+
         std::cout << "  implementation: " << impl.first << std::endl;
 
         auto before = std::chrono::steady_clock::now();
 
         // Execute the test on the current implementation
-        test.second(impl.second);
+        test.fun(impl.second);
 
         auto after = std::chrono::steady_clock::now();
         auto delta_us =
@@ -102,6 +122,10 @@ public:
                   << std::endl;
         std::cout << "\t tolerance:    " << impl.second->tolerance()
                   << std::endl;
+        std::cout << "\t evaluations:  " << impl.second->evaluations()
+                  << std::endl;
+        std::cout << "\t status:       " << toString(impl.second->status())
+                  << std::endl;
       }
     }
   }
@@ -110,8 +134,16 @@ private:
   /// Map from implementation name to minimizer instance.
   std::map<std::string, minimizerPtr> impls;
 
-  /// List of (test name, test function) pairs.
-  std::vector<std::pair<std::string, testFunction>> tests;
+  /// A registered test.
+  struct Test {
+    std::string name;
+    testFunction fun;
+    /// Implementations the test runs on (empty: all of them).
+    std::vector<std::string> only;
+  };
+
+  /// Registered tests, in order.
+  std::vector<Test> tests;
 };
 
 } // namespace Tests